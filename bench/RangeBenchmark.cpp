@@ -0,0 +1,284 @@
+#include <BatchDriver.h>
+#include <RangeComparison.h>
+#include <llvm/Analysis/AssumptionCache.h>
+#include <llvm/Analysis/LazyValueInfo.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Analysis/ValueTracking.h>
+#include <llvm/IR/Dominators.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/ToolOutputFile.h>
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <vector>
+
+// runs IntervalAnalysis, LazyValueInfo and ValueTracking's computeConstantRange over the same functions
+// and compares their cost and the ranges they give for the same values:
+//
+//   codepunk-bench [-format=csv|json] [-o <file>] <input.ll|input.bc|directory|@response-file>...
+//
+// a function is queried block by block, for the integer values each block defines or reads,
+// at the end of the block. values codepunk does not track have the full range of their type.
+// memory is what the heap holds once all queries are answered, both sides only ever grow their caches
+
+using namespace llvm;
+
+enum Format { CSV, JSON };
+
+static cl::list<std::string> InputFilenames(cl::Positional,
+        cl::desc("filenames of LLVM IR input, directories or @response-files"));
+static cl::opt<Format> OutputFormat("format", cl::desc("output format"), cl::init(CSV), cl::values(
+        clEnumValN(CSV, "csv", "one line per function"),
+        clEnumValN(JSON, "json", "an array of one object per function")));
+static cl::opt<std::string> OutputFilename("o", cl::desc("output file"), cl::value_desc("filename"), cl::init("-"));
+static cl::opt<int> MaxIteration("iterate", cl::desc("max iteration count"),
+        cl::value_desc("number"), cl::init(-1));
+static cl::opt<bool> AccelerateLoops("accelerate-loops",
+        cl::desc("evaluate simple induction loops in closed form instead of iterating them"), cl::init(true));
+
+struct FunctionResult {
+    std::string module, function;
+    size_t blocks = 0, queries = 0;
+
+    double codepunkMs = 0, lviMs = 0, valueTrackingMs = 0;
+    size_t codepunkBytes = 0, lviBytes = 0;
+
+    RangeComparison vsLvi, vsValueTracking;
+};
+
+// integer values defined or read in `bb` that are available at its end
+static std::vector<Value*> queriedValues(BasicBlock &bb, const DominatorTree &dt) {
+    std::set<Value*> values;
+
+    for(auto &inst : bb) {
+        if(inst.getType()->isIntegerTy()) {
+            values.insert(&inst);
+        }
+
+        // phis read their operands on the incoming edges
+        if(isa<PHINode>(inst)) {
+            continue;
+        }
+
+        for(auto &op : inst.operands()) {
+            if(!op->getType()->isIntegerTy()) {
+                continue;
+            }
+
+            auto def = dyn_cast<Instruction>(op);
+            if(isa<Argument>(op) || (def && dt.dominates(def, bb.getTerminator()))) {
+                values.insert(op);
+            }
+        }
+    }
+
+    return {values.begin(), values.end()};
+}
+
+template <typename F>
+static double measureMs(F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static FunctionResult benchmark(Function &f, const std::string &module) {
+    FunctionResult res;
+    res.module = module;
+    res.function = f.getName().str();
+
+    DominatorTree dt(f);
+    std::vector<std::pair<BasicBlock*, std::vector<Value*>>> queries;
+    for(auto &bb : f) {
+        if(dt.isReachableFromEntry(&bb)) {
+            queries.emplace_back(&bb, queriedValues(bb, dt));
+            res.queries += queries.back().second.size();
+        }
+    }
+    res.blocks = queries.size();
+
+    IntervalAnalysisOptions options;
+    options.accelerateLoops = AccelerateLoops;
+
+    std::vector<ConstantRange> ours, lvi, valueTracking;
+
+    auto before = sys::Process::GetMallocUsage();
+    {
+        std::unique_ptr<IntervalAnalysis> analysis;
+        res.codepunkMs = measureMs([&] {
+            analysis = std::make_unique<IntervalAnalysis>(&f, options);
+            analysis->analyze(MaxIteration);
+
+            auto states = analysis->atAll();
+            for(auto &[bb, values] : queries) {
+                const auto &symbols = states.at(bb);
+                for(auto v : values) {
+                    auto iter = symbols.find(v);
+                    ours.push_back(iter != symbols.end() ? toConstantRange(iter->second) :
+                            ConstantRange::getFull(v->getType()->getIntegerBitWidth()));
+                }
+            }
+        });
+        res.codepunkBytes = sys::Process::GetMallocUsage() - before;
+    }
+
+    before = sys::Process::GetMallocUsage();
+    {
+        // what LazyValueAnalysis and the analyses it asks for need, without a PassBuilder pulling in every pass
+        FunctionAnalysisManager fam;
+        fam.registerPass([] { return PassInstrumentationAnalysis(); });
+        fam.registerPass([] { return TargetIRAnalysis(); });
+        fam.registerPass([] { return DominatorTreeAnalysis(); });
+        fam.registerPass([] { return AssumptionAnalysis(); });
+        fam.registerPass([] { return TargetLibraryAnalysis(); });
+        fam.registerPass([] { return LazyValueAnalysis(); });
+
+        res.lviMs = measureMs([&] {
+            auto &info = fam.getResult<LazyValueAnalysis>(f);
+
+            for(auto &[bb, values] : queries) {
+                for(auto v : values) {
+                    lvi.push_back(info.getConstantRange(v, bb, bb->getTerminator()));
+                }
+            }
+        });
+        res.lviBytes = sys::Process::GetMallocUsage() - before;
+    }
+
+    res.valueTrackingMs = measureMs([&] {
+        for(auto &[bb, values] : queries) {
+            for(auto v : values) {
+                valueTracking.push_back(computeConstantRange(v));
+            }
+        }
+    });
+
+    for(size_t i = 0; i < ours.size(); i++) {
+        res.vsLvi.add(ours[i], lvi[i]);
+        res.vsValueTracking.add(ours[i], valueTracking[i]);
+    }
+
+    return res;
+}
+
+static const char *Columns = "module,function,blocks,queries,codepunk_ms,lvi_ms,valuetracking_ms,"
+        "codepunk_bytes,lvi_bytes,"
+        "lvi_tighter,lvi_looser,lvi_equal,lvi_incomparable,lvi_disjoint,"
+        "vt_tighter,vt_looser,vt_equal,vt_incomparable,vt_disjoint";
+
+static void printCsv(raw_ostream &o, const FunctionResult &res) {
+    o << res.module << "," << res.function << "," << res.blocks << "," << res.queries << ","
+      << format("%.3f,%.3f,%.3f", res.codepunkMs, res.lviMs, res.valueTrackingMs) << ","
+      << res.codepunkBytes << "," << res.lviBytes;
+
+    for(const auto &c : {res.vsLvi, res.vsValueTracking}) {
+        o << "," << c.tighter << "," << c.looser << "," << c.equal << "," << c.incomparable << "," << c.disjoint;
+    }
+    o << "\n";
+}
+
+static void printJson(json::OStream &o, const FunctionResult &res) {
+    auto comparison = [&](const char *name, const RangeComparison &c) {
+        o.attributeObject(name, [&] {
+            o.attribute("tighter", int64_t(c.tighter));
+            o.attribute("looser", int64_t(c.looser));
+            o.attribute("equal", int64_t(c.equal));
+            o.attribute("incomparable", int64_t(c.incomparable));
+            o.attribute("disjoint", int64_t(c.disjoint));
+        });
+    };
+
+    o.object([&] {
+        o.attribute("module", res.module);
+        o.attribute("function", res.function);
+        o.attribute("blocks", int64_t(res.blocks));
+        o.attribute("queries", int64_t(res.queries));
+        o.attribute("codepunk_ms", res.codepunkMs);
+        o.attribute("lvi_ms", res.lviMs);
+        o.attribute("valuetracking_ms", res.valueTrackingMs);
+        o.attribute("codepunk_bytes", int64_t(res.codepunkBytes));
+        o.attribute("lvi_bytes", int64_t(res.lviBytes));
+        comparison("lvi", res.vsLvi);
+        comparison("valuetracking", res.vsValueTracking);
+    });
+}
+
+int main(int argc, char *argv[]) {
+    cl::ParseCommandLineOptions(argc, argv);
+
+    std::error_code ec;
+    ToolOutputFile out(OutputFilename, ec, sys::fs::OF_Text);
+    if(ec) {
+        errs() << OutputFilename << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    std::vector<FunctionResult> results;
+    int res = 0;
+
+    for(const auto &input : collectInputs(InputFilenames, errs())) {
+        auto buffer = MemoryBuffer::getFileOrSTDIN(input);
+        if(!buffer) {
+            errs() << input << ": " << buffer.getError().message() << "\n";
+            res = 1;
+            continue;
+        }
+
+        LLVMContext ctx;
+        std::string error;
+        auto mod = parseModule(buffer.get()->getMemBufferRef(), ctx, error);
+        if(!mod) {
+            errs() << input << ": " << error << "\n";
+            res = 1;
+            continue;
+        }
+
+        for(auto &f : *mod) {
+            if(!f.isDeclaration()) {
+                results.push_back(benchmark(f, input));
+            }
+        }
+    }
+
+    if(OutputFormat == CSV) {
+        out.os() << Columns << "\n";
+        for(const auto &result : results) {
+            printCsv(out.os(), result);
+        }
+    } else {
+        json::OStream o(out.os(), 2);
+        o.array([&] {
+            for(const auto &result : results) {
+                printJson(o, result);
+            }
+        });
+        out.os() << "\n";
+    }
+
+    // totals for a quick look, the per function results are for tracking
+    FunctionResult total;
+    for(const auto &result : results) {
+        total.queries += result.queries;
+        total.codepunkMs += result.codepunkMs;
+        total.lviMs += result.lviMs;
+        total.valueTrackingMs += result.valueTrackingMs;
+        total.vsLvi += result.vsLvi;
+        total.vsValueTracking += result.vsValueTracking;
+    }
+
+    errs() << results.size() << " functions, " << total.queries << " queries: "
+           << format("codepunk %.3f ms, lvi %.3f ms, valuetracking %.3f ms\n",
+                   total.codepunkMs, total.lviMs, total.valueTrackingMs)
+           << "vs lvi: " << total.vsLvi.tighter << " tighter, " << total.vsLvi.looser << " looser, "
+           << total.vsLvi.disjoint << " disjoint\n"
+           << "vs valuetracking: " << total.vsValueTracking.tighter << " tighter, "
+           << total.vsValueTracking.looser << " looser, " << total.vsValueTracking.disjoint << " disjoint\n";
+
+    out.keep();
+    return res;
+}
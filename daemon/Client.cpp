@@ -0,0 +1,103 @@
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "DaemonProtocol.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> InputFilename(cl::Positional, cl::desc("filename of LLVM IR input"));
+static cl::opt<int> MaxIteration("iterate", cl::desc("max iteration count"),
+        cl::value_desc("number"), cl::init(-1));
+static cl::opt<bool> CheckpointStates("checkpoint-states",
+        cl::desc("keep block states only at join points, loop heads and exits to save memory"));
+static cl::opt<bool> Tiered("tiered",
+        cl::desc("run a linear triage pass first and the full fixpoint only where it is needed"));
+static cl::opt<bool> AccelerateLoops("accelerate-loops",
+        cl::desc("evaluate simple induction loops in closed form instead of iterating them"), cl::init(true));
+static cl::opt<bool> PruneDead("prune-dead",
+        cl::desc("drop values from block states once they are no longer live"));
+static cl::opt<unsigned> IterationBudget("budget-iterations",
+        cl::desc("per-function iteration budget before degrading to a coarse result (0 for unlimited)"),
+        cl::value_desc("number"), cl::init(0));
+static cl::opt<unsigned> TimeBudget("budget-ms",
+        cl::desc("per-function wall-clock budget in milliseconds (0 for unlimited)"),
+        cl::value_desc("milliseconds"), cl::init(0));
+static cl::opt<size_t> MemoryBudget("budget-memory",
+        cl::desc("per-function budget on abstract state memory in bytes (0 for unlimited)"),
+        cl::value_desc("bytes"), cl::init(0));
+static cl::opt<AnalysisDomain> Domain("domain", cl::desc("abstract domain of the analysis"),
+        cl::values(clEnumValN(AnalysisDomain::Interval, "interval", "intervals with closed-form loops (default)"),
+                   clEnumValN(AnalysisDomain::WidenedInterval, "interval-widen", "intervals widened at loop heads"),
+                   clEnumValN(AnalysisDomain::Constant, "constant", "single constants"),
+                   clEnumValN(AnalysisDomain::Sign, "sign", "signs of values")),
+        cl::init(AnalysisDomain::Interval));
+static cl::opt<std::string> SocketPath("socket", cl::desc("path of the codepunkd socket"),
+        cl::value_desc("path"), cl::init(defaultSocketPath()));
+static cl::opt<bool> SendInline("inline", cl::desc("send the input contents instead of its path"));
+
+int main(int argc, char *argv[]) {
+    cl::ParseCommandLineOptions(argc, argv);
+
+    if(InputFilename.empty()) {
+        errs() << "filename is expected";
+        abort();
+    }
+
+    DaemonRequest request;
+    request.options.maxIteration = MaxIteration;
+    request.options.analysis.checkpointOnly = CheckpointStates;
+    request.options.analysis.tiered = Tiered;
+    request.options.analysis.accelerateLoops = AccelerateLoops;
+    request.options.analysis.pruneDead = PruneDead;
+    request.options.analysis.iterationBudget = IterationBudget;
+    request.options.analysis.timeBudgetMs = TimeBudget;
+    request.options.analysis.memoryBudget = MemoryBudget;
+    request.options.domain = Domain;
+
+    if(SendInline || InputFilename == "-") {
+        auto buffer = MemoryBuffer::getFileOrSTDIN(InputFilename);
+        if(!buffer) {
+            errs() << buffer.getError().message();
+            abort();
+        }
+
+        request.isInline = true;
+        request.payload = buffer.get()->getBuffer().str();
+    } else {
+        SmallString<256> path(InputFilename.getValue());
+        sys::fs::make_absolute(path);
+        request.path = path.str().str();
+    }
+
+    sockaddr_un addr;
+    if(!makeSocketAddress(SocketPath, addr)) {
+        errs() << "socket path is too long";
+        abort();
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || ::connect(fd, (sockaddr *)&addr, sizeof addr) < 0) {
+        errs() << SocketPath << ": " << std::strerror(errno) << " (is codepunkd running?)";
+        abort();
+    }
+
+    SocketStream stream(fd);
+    std::string status, response;
+    if(!stream.write(request.encode()) || !stream.read(1, status)) {
+        errs() << "connection to codepunkd lost";
+        abort();
+    }
+
+    stream.readAll(response);
+    ::close(fd);
+
+    if(status != "0") {
+        errs() << response;
+        abort();
+    }
+
+    outs() << response;
+}
@@ -0,0 +1,272 @@
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <csignal>
+
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "DaemonProtocol.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> SocketPath("socket", cl::desc("path of the unix domain socket to listen on"),
+        cl::value_desc("path"), cl::init(defaultSocketPath()));
+static cl::opt<unsigned> Threads("j", cl::desc("number of worker threads (0 for one per core)"),
+        cl::value_desc("number"), cl::init(0));
+static cl::opt<unsigned> CacheSize("cache-size", cl::desc("number of analysis results kept in memory"),
+        cl::value_desc("number"), cl::init(1024));
+static cl::opt<unsigned> ContextReuse("context-reuse", cl::desc("requests served by a worker LLVMContext before it is recreated"),
+        cl::value_desc("number"), cl::init(256));
+static cl::opt<unsigned> IdleTimeout("idle-timeout", cl::desc("seconds a connection may stay silent before it is closed (0 for no limit)"),
+        cl::value_desc("seconds"), cl::init(30));
+
+// LRU cache of analysis outputs keyed by input identity and options
+struct ResultCache {
+    std::mutex mutex;
+    std::list<std::pair<std::string, std::string>> entries;
+    std::unordered_map<std::string, decltype(entries)::iterator> index;
+
+    bool lookup(const std::string& key, std::string& out) {
+        std::lock_guard lock(mutex);
+
+        auto iter = index.find(key);
+        if(iter == index.end()) {
+            return false;
+        }
+
+        entries.splice(entries.begin(), entries, iter->second);
+        out = iter->second->second;
+        return true;
+    }
+
+    void insert(const std::string& key, const std::string& value) {
+        std::lock_guard lock(mutex);
+
+        if(CacheSize == 0 || index.count(key)) {
+            return;
+        }
+
+        entries.emplace_front(key, value);
+        index.emplace(key, entries.begin());
+
+        while(entries.size() > CacheSize) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+};
+
+static ResultCache cache;
+
+// every worker keeps its own context warm across requests
+static LLVMContext &workerContext() {
+    thread_local std::unique_ptr<LLVMContext> ctx;
+    thread_local unsigned uses = 0;
+
+    if(!ctx || uses++ >= ContextReuse) {
+        ctx = std::make_unique<LLVMContext>();
+        uses = 1;
+    }
+
+    return *ctx;
+}
+
+static bool handle(const DaemonRequest& request, std::string& out) {
+    std::string key = request.encodeOptions();
+
+    std::unique_ptr<MemoryBuffer> buffer;
+    if(request.isInline) {
+        key += "inline=" + utohexstr(xxHash64(request.payload)) + ":" + std::to_string(request.payload.size());
+        buffer = MemoryBuffer::getMemBuffer(request.payload, "<inline>", false);
+    } else {
+        sys::fs::file_status status;
+        if(auto ec = sys::fs::status(request.path, status)) {
+            out = request.path + ": " + ec.message();
+            return false;
+        }
+
+        key += "path=" + request.path + ":" + std::to_string(status.getSize()) + ":" +
+                std::to_string(status.getLastModificationTime().time_since_epoch().count());
+    }
+
+    if(cache.lookup(key, out)) {
+        return true;
+    }
+
+    if(!buffer) {
+        auto file = MemoryBuffer::getFile(request.path);
+        if(!file) {
+            out = request.path + ": " + file.getError().message();
+            return false;
+        }
+
+        buffer = std::move(file.get());
+    }
+
+    auto mod = parseModule(buffer->getMemBufferRef(), workerContext(), out);
+    if(!mod) {
+        return false;
+    }
+
+    raw_string_ostream o(out);
+    analyzeModule(*mod, request.options, o);
+    o.flush();
+
+    cache.insert(key, out);
+    return true;
+}
+
+static void serve(int fd) {
+    // a client that connects and never sends, or never reads the response, would hold a worker forever
+    if(IdleTimeout) {
+        timeval timeout{time_t(IdleTimeout), 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+    }
+
+    SocketStream stream(fd);
+
+    std::string out;
+    errno = 0;
+    if(auto request = stream.readRequest()) {
+        bool ok = handle(*request, out);
+        stream.write(ok ? "0" : "1") && stream.write(out);
+    } else {
+        bool idle = errno == EAGAIN || errno == EWOULDBLOCK;
+        stream.write("1") && stream.write(idle ? "idle connection closed" : "malformed request");
+    }
+
+    ::close(fd);
+}
+
+static char SocketPathToRemove[sizeof(sockaddr_un::sun_path)];
+
+static void onTerminate(int) {
+    ::unlink(SocketPathToRemove);
+    ::_exit(0);
+}
+
+// the directory of the default socket has to be private to the user: one someone else made in /tmp
+// would let them replace the socket under the clients
+static bool makePrivateDirectory(const std::string& dir) {
+    if(::mkdir(dir.c_str(), 0700) == 0) {
+        return true;
+    }
+
+    struct stat st{};
+    if(errno != EEXIST || ::lstat(dir.c_str(), &st) < 0) {
+        return false;
+    }
+    if(!S_ISDIR(st.st_mode) || st.st_uid != ::getuid() || (st.st_mode & 077)) {
+        errno = EACCES;
+        return false;
+    }
+
+    return true;
+}
+
+// a socket left behind by an earlier run is replaced, anything else at the path is not ours to remove
+static bool removeStaleSocket(const char *path) {
+    struct stat st{};
+    if(::lstat(path, &st) < 0) {
+        return errno == ENOENT;
+    }
+    if(!S_ISSOCK(st.st_mode) || st.st_uid != ::getuid()) {
+        errno = EEXIST;
+        return false;
+    }
+
+    return ::unlink(path) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    cl::ParseCommandLineOptions(argc, argv, "codepunk resident analysis daemon\n");
+
+    sockaddr_un addr;
+    if(!makeSocketAddress(SocketPath, addr)) {
+        errs() << "socket path is too long";
+        abort();
+    }
+
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFd < 0) {
+        errs() << "socket: " << std::strerror(errno);
+        abort();
+    }
+
+    if(!SocketPath.getNumOccurrences() && !makePrivateDirectory(sys::path::parent_path(SocketPath).str())) {
+        errs() << sys::path::parent_path(SocketPath) << ": " << std::strerror(errno);
+        abort();
+    }
+    if(!removeStaleSocket(addr.sun_path)) {
+        errs() << SocketPath << ": " << (errno == EEXIST ? "not a socket of this user, leaving it alone" : std::strerror(errno));
+        abort();
+    }
+
+    // only the user may connect, whatever the umask the daemon was started with
+    auto mask = ::umask(077);
+    bool bound = ::bind(listenFd, (sockaddr *)&addr, sizeof addr) == 0;
+    ::umask(mask);
+
+    if(!bound || ::listen(listenFd, SOMAXCONN) < 0) {
+        errs() << SocketPath << ": " << std::strerror(errno);
+        abort();
+    }
+
+    std::memcpy(SocketPathToRemove, addr.sun_path, sizeof SocketPathToRemove);
+    std::signal(SIGINT, onTerminate);
+    std::signal(SIGTERM, onTerminate);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::queue<int> pending;
+
+    unsigned threadCount = Threads ? Threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    for(unsigned i = 0; i < threadCount; i++) {
+        workers.emplace_back([&] {
+            while(true) {
+                int fd;
+                {
+                    std::unique_lock lock(mutex);
+                    ready.wait(lock, [&] { return !pending.empty(); });
+
+                    fd = pending.front();
+                    pending.pop();
+                }
+
+                serve(fd);
+            }
+        });
+    }
+
+    while(true) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if(fd < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) continue;
+
+            errs() << "accept: " << std::strerror(errno);
+            abort();
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            pending.push(fd);
+        }
+        ready.notify_one();
+    }
+}
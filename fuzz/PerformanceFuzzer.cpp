@@ -0,0 +1,195 @@
+#include <IntervalAnalysis.h>
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// libFuzzer target that hunts for slow inputs rather than crashes: every input is turned into
+// a small but valid function over integer slots, and the cost of analyzing it is fed back to the fuzzer.
+//
+//   clang: cmake -DCODEPUNK_FUZZ=ON ..., then codepunk-fuzz <corpus dir> [libFuzzer options]
+//
+// inputs that are the slowest seen so far are written to $CODEPUNK_SLOW_CORPUS (slow-corpus by default),
+// both as the raw fuzzer input and as the generated IR, which codepunk reads directly
+
+// libFuzzer keeps an input when it sets a counter no earlier input did, so marking the order of magnitude
+// of the iteration count and of the allocated bytes steers the search towards ever more expensive inputs
+__attribute__((used, section("__libfuzzer_extra_counters")))
+static uint8_t costCounters[2][64];
+
+// slow inputs are capped so a single run cannot stall the fuzzer
+static constexpr unsigned IterationBudget = 1u << 16u;
+static constexpr size_t SlowThreshold = 256;
+
+struct FuzzInput {
+    const uint8_t *data;
+    size_t size;
+
+    uint8_t next() {
+        if(!size) return 0;
+        size--;
+        return *data++;
+    }
+
+    unsigned below(unsigned n) {
+        return next() % n;
+    }
+};
+
+static llvm::Function *buildFunction(llvm::Module &mod, FuzzInput &in) {
+    auto &ctx = mod.getContext();
+    auto i32 = llvm::Type::getInt32Ty(ctx);
+
+    unsigned argCount = 1 + in.below(3), slotCount = 1 + in.below(4), blockCount = 1 + in.below(12);
+
+    auto fnTy = llvm::FunctionType::get(i32, std::vector<llvm::Type*>(argCount, i32), false);
+    auto f = llvm::Function::Create(fnTy, llvm::Function::ExternalLinkage, "fuzz", mod);
+
+    auto entry = llvm::BasicBlock::Create(ctx, "entry", f);
+    std::vector<llvm::BasicBlock*> blocks;
+    for(unsigned i = 0; i < blockCount; i++) {
+        blocks.push_back(llvm::BasicBlock::Create(ctx, "bb" + std::to_string(i), f));
+    }
+
+    llvm::IRBuilder<> builder(entry);
+
+    auto constant = [&] {
+        static const int32_t edges[] = {0, 1, -1, 2, 10, 100, INT32_MAX, INT32_MIN};
+        auto c = in.next();
+        return llvm::ConstantInt::get(i32, c & 0x80u ? edges[c % 8] : int8_t(c << 1u) >> 1, true);
+    };
+    auto arg = [&] {
+        return f->getArg(in.below(argCount));
+    };
+
+    std::vector<llvm::Value*> slots;
+    for(unsigned i = 0; i < slotCount; i++) {
+        slots.push_back(builder.CreateAlloca(i32, nullptr, "s" + std::to_string(i)));
+    }
+    for(auto slot : slots) {
+        builder.CreateStore(in.below(2) ? static_cast<llvm::Value*>(arg()) : constant(), slot);
+    }
+    builder.CreateBr(blocks.front());
+
+    auto slot = [&] {
+        return slots[in.below(slotCount)];
+    };
+    auto load = [&] {
+        return builder.CreateLoad(i32, slot());
+    };
+    auto operand = [&] {
+        return in.below(2) ? static_cast<llvm::Value*>(load()) : constant();
+    };
+
+    for(auto bb : blocks) {
+        builder.SetInsertPoint(bb);
+
+        for(unsigned i = in.below(6); i > 0; i--) {
+            switch (in.below(5)) {
+                case 0:
+                    builder.CreateStore(constant(), slot());
+                    break;
+                case 1:
+                    builder.CreateStore(arg(), slot());
+                    break;
+                case 2:
+                    builder.CreateStore(builder.CreateAdd(load(), operand()), slot());
+                    break;
+                case 3:
+                    builder.CreateStore(builder.CreateSub(load(), operand()), slot());
+                    break;
+                default:
+                    builder.CreateStore(builder.CreateMul(load(), operand()), slot());
+                    break;
+            }
+        }
+
+        static const llvm::CmpInst::Predicate predicates[] = {
+                llvm::CmpInst::ICMP_EQ, llvm::CmpInst::ICMP_NE, llvm::CmpInst::ICMP_SLT,
+                llvm::CmpInst::ICMP_SLE, llvm::CmpInst::ICMP_SGT, llvm::CmpInst::ICMP_SGE};
+
+        switch (in.below(4)) {
+            case 0:
+                builder.CreateBr(blocks[in.below(blockCount)]);
+                break;
+            case 1:
+                builder.CreateRet(load());
+                break;
+            default: {
+                auto cond = builder.CreateICmp(predicates[in.below(6)], load(), operand());
+                auto t = blocks[in.below(blockCount)], e = blocks[in.below(blockCount)];
+                builder.CreateCondBr(cond, t, e);
+                break;
+            }
+        }
+    }
+
+    return f;
+}
+
+static void saveSlowInput(const uint8_t *data, size_t size, const llvm::Module &mod, size_t iterations) {
+    auto dir = std::getenv("CODEPUNK_SLOW_CORPUS");
+    std::string corpus = dir ? dir : "slow-corpus";
+    llvm::sys::fs::create_directories(corpus);
+
+    auto hash = llvm::hash_combine_range(data, data + size);
+    llvm::SmallString<128> path(corpus);
+    llvm::sys::path::append(path, std::to_string(iterations) + "-" + llvm::utohexstr(size_t(hash)));
+
+    std::error_code ec;
+    llvm::raw_fd_ostream raw(path, ec, llvm::sys::fs::OF_None);
+    if(!ec) raw.write(reinterpret_cast<const char*>(data), size);
+
+    llvm::raw_fd_ostream ir(path.str().str() + ".ll", ec, llvm::sys::fs::OF_Text);
+    if(!ec) ir << mod;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static size_t slowest = SlowThreshold;
+
+    FuzzInput in{data, size};
+
+    // the first byte picks the analysis mode, so blow-ups are searched for in all of them
+    auto modes = in.next();
+    IntervalAnalysisOptions options;
+    options.checkpointOnly = modes & 1u;
+    options.tiered = modes & 2u;
+    options.accelerateLoops = !(modes & 4u);
+    options.pruneDead = modes & 8u;
+    options.iterationBudget = IterationBudget;
+
+    llvm::LLVMContext ctx;
+    llvm::Module mod("fuzz", ctx);
+    auto f = buildFunction(mod, in);
+
+    if(llvm::verifyFunction(*f, &llvm::errs())) {
+        std::abort();
+    }
+
+    IntervalAnalysis analysis(f, options);
+    analysis.analyze();
+
+    // what the arena took from the heap
+    auto iterations = analysis.iterations;
+    auto bytes = analysis.memory->heap.counter.allocatedBytes;
+
+    costCounters[0][llvm::Log2_64(iterations | 1u)] = 1;
+    costCounters[1][llvm::Log2_64(bytes | 1u)] = 1;
+
+    if(iterations > slowest) {
+        slowest = iterations;
+        saveSlowInput(data, size, mod, iterations);
+    }
+
+    return 0;
+}
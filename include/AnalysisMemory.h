@@ -0,0 +1,112 @@
+#ifndef CODEPUNK_ANALYSISMEMORY_H
+#define CODEPUNK_ANALYSISMEMORY_H
+
+#include <Arena.h>
+#include <llvm/Support/JSON.h>
+
+#include <array>
+#include <cstddef>
+
+// what an analysis run allocates, by subsystem, with the high-water marks of each phase.
+// everything but the wide interval words goes through the arena, whose chunks are counted as `heap`.
+// decoded blocks and constant propagation live on the global heap and are not counted
+struct AnalysisMemory {
+    enum Subsystem { Heap, States, Table, Expressions, Wide, SubsystemCount };
+    enum Phase { Decode, Triage, Fixpoint, PhaseCount };
+
+    // chunks the arena takes from the heap, they hold the states, table and expressions
+    CountingResource heap;
+    Arena arena{&heap};
+
+    // block states, the interval table with its index and memos,
+    // and the expression nodes and symbol tables refinement hands to the solver
+    CountingResource states{&arena}, table{&arena}, expressions{&arena};
+
+    // words of the intervals wider than 64 bits the table holds, APInt keeps them on the heap
+    MemoryCounter wide;
+
+    // high-water mark in bytes of each subsystem during each phase
+    std::array<std::array<size_t, SubsystemCount>, PhaseCount> peaks{};
+
+    [[nodiscard]] const MemoryCounter &counter(Subsystem subsystem) const {
+        switch (subsystem) {
+            case Heap:
+                return heap.counter;
+            case States:
+                return states.counter;
+            case Table:
+                return table.counter;
+            case Expressions:
+                return expressions.counter;
+            default:
+                return wide;
+        }
+    }
+
+    MemoryCounter &counter(Subsystem subsystem) {
+        return const_cast<MemoryCounter&>(static_cast<const AnalysisMemory*>(this)->counter(subsystem));
+    }
+
+    // folds the high-water marks since the last phase ended into `phase`, and starts counting the next one
+    void endPhase(Phase phase) {
+        for(int s = 0; s < SubsystemCount; s++) {
+            auto &c = counter(Subsystem(s));
+            peaks[phase][s] = std::max(peaks[phase][s], c.peakBytes);
+            c.peakBytes = c.bytes;
+        }
+    }
+
+    // high-water mark of a subsystem over all phases
+    [[nodiscard]] size_t peak(Subsystem subsystem) const {
+        size_t res = counter(subsystem).peakBytes;
+        for(const auto &phase : peaks) {
+            res = std::max(res, phase[subsystem]);
+        }
+
+        return res;
+    }
+
+    // high-water mark of what the analysis held, the arena chunks and the wide intervals
+    [[nodiscard]] size_t peakBytes() const {
+        return peak(Heap) + peak(Wide);
+    }
+
+    static const char *subsystemName(Subsystem subsystem) {
+        static const char *names[] = {"heap", "states", "table", "expressions", "wide"};
+        return names[subsystem];
+    }
+
+    static const char *phaseName(Phase phase) {
+        static const char *names[] = {"decode", "triage", "fixpoint"};
+        return names[phase];
+    }
+};
+
+// {"peak_bytes", "subsystems": {<subsystem>: {"peak", "allocated", "allocations"}}, "phases": {<phase>: {<subsystem>: peak}}}
+inline void printAnalysisMemory(llvm::json::OStream &o, const AnalysisMemory &memory) {
+    using Subsystem = AnalysisMemory::Subsystem;
+    using Phase = AnalysisMemory::Phase;
+
+    o.attribute("peak_bytes", int64_t(memory.peakBytes()));
+    o.attributeObject("subsystems", [&] {
+        for(int s = 0; s < AnalysisMemory::SubsystemCount; s++) {
+            const auto &c = memory.counter(Subsystem(s));
+            o.attributeObject(AnalysisMemory::subsystemName(Subsystem(s)), [&] {
+                o.attribute("peak", int64_t(memory.peak(Subsystem(s))));
+                o.attribute("allocated", int64_t(c.allocatedBytes));
+                o.attribute("allocations", int64_t(c.allocations));
+            });
+        }
+    });
+    o.attributeObject("phases", [&] {
+        for(int p = 0; p < AnalysisMemory::PhaseCount; p++) {
+            o.attributeObject(AnalysisMemory::phaseName(Phase(p)), [&] {
+                for(int s = 0; s < AnalysisMemory::SubsystemCount; s++) {
+                    o.attribute(AnalysisMemory::subsystemName(Subsystem(s)), int64_t(memory.peaks[p][s]));
+                }
+            });
+        }
+    });
+}
+
+#endif //CODEPUNK_ANALYSISMEMORY_H
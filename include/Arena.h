@@ -0,0 +1,90 @@
+#ifndef CODEPUNK_ARENA_H
+#define CODEPUNK_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+// memory of a single analysis run: small blocks are pooled by size and recycled while the analysis
+// iterates, and the chunks behind them are all given back at once when the analysis is destroyed.
+// an analysis only ever runs on one thread, so the pool needs no locking
+using Arena = std::pmr::unsynchronized_pool_resource;
+
+// bytes and objects held right now, the most bytes held at once, and everything ever allocated
+struct MemoryCounter {
+    size_t bytes = 0, objects = 0;
+    size_t peakBytes = 0;
+    size_t allocatedBytes = 0, allocations = 0;
+
+    void allocate(size_t size) {
+        bytes += size;
+        objects++;
+        peakBytes = std::max(peakBytes, bytes);
+        allocatedBytes += size;
+        allocations++;
+    }
+
+    void deallocate(size_t size) {
+        bytes -= size;
+        objects--;
+    }
+};
+
+// counts what goes through it on the way to `upstream`
+struct CountingResource : std::pmr::memory_resource {
+    std::pmr::memory_resource *upstream;
+    MemoryCounter counter;
+
+    explicit CountingResource(std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+        : upstream(upstream) {}
+
+    void *do_allocate(size_t size, size_t alignment) override {
+        auto p = upstream->allocate(size, alignment);
+        counter.allocate(size);
+        return p;
+    }
+
+    void do_deallocate(void *p, size_t size, size_t alignment) override {
+        upstream->deallocate(p, size, alignment);
+        counter.deallocate(size);
+    }
+
+    [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+// a polymorphic allocator that stays with its container when the container is copied,
+// std::pmr::polymorphic_allocator falls back to the default resource there,
+// which would send every copied state back to the global heap
+template <typename T>
+struct ArenaAllocator : std::pmr::polymorphic_allocator<T> {
+    using std::pmr::polymorphic_allocator<T>::polymorphic_allocator;
+
+    ArenaAllocator() = default;
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : std::pmr::polymorphic_allocator<T>(other.resource()) {}
+
+    [[nodiscard]] ArenaAllocator select_on_container_copy_construction() const {
+        return *this;
+    }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template <typename K, typename V>
+using ArenaMap = std::map<K, V, std::less<K>, ArenaAllocator<std::pair<const K, V>>>;
+
+template <typename K, typename V>
+using ArenaHashMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>, ArenaAllocator<std::pair<const K, V>>>;
+
+template <typename K, typename V>
+using ArenaHashMultimap = std::unordered_multimap<K, V, std::hash<K>, std::equal_to<K>,
+        ArenaAllocator<std::pair<const K, V>>>;
+
+#endif //CODEPUNK_ARENA_H
@@ -0,0 +1,145 @@
+#ifndef CODEPUNK_BATCHDRIVER_H
+#define CODEPUNK_BATCHDRIVER_H
+
+#include <Driver.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <vector>
+
+// expands directories into the .ll/.bc files below them, other paths are kept as they are
+inline std::vector<std::string> collectInputs(const std::vector<std::string>& paths, llvm::raw_ostream& err) {
+    std::vector<std::string> inputs;
+
+    for(const auto& path : paths) {
+        if(!llvm::sys::fs::is_directory(path)) {
+            inputs.push_back(path);
+            continue;
+        }
+
+        std::vector<std::string> found;
+        std::error_code ec;
+        for(llvm::sys::fs::recursive_directory_iterator iter(path, ec), end; iter != end && !ec; iter.increment(ec)) {
+            auto ext = llvm::sys::path::extension(iter->path());
+            if((ext == ".ll" || ext == ".bc") && llvm::sys::fs::is_regular_file(iter->path())) {
+                found.push_back(iter->path());
+            }
+        }
+
+        if(ec) {
+            err << path << ": " << ec.message() << "\n";
+        }
+
+        std::sort(found.begin(), found.end());
+        inputs.insert(inputs.end(), found.begin(), found.end());
+    }
+
+    return inputs;
+}
+
+// three stage pipeline: files are parsed in parallel (one LLVMContext each), their functions are
+// analyzed by a second pool, and a single writer emits the results in input order.
+// at most `window` files are in flight at once, which bounds the memory held by parsed modules
+// and pending outputs.
+struct BatchDriver {
+    DriverOptions options;
+    unsigned jobs;
+    unsigned window;
+
+    struct ParsedFile {
+        std::unique_ptr<llvm::LLVMContext> ctx;
+        std::unique_ptr<llvm::Module> mod;
+        std::string error;
+        std::vector<std::shared_future<std::string>> functions;
+    };
+
+    BatchDriver(const DriverOptions& options, unsigned jobs)
+        : options(options), jobs(std::max(1u, jobs)), window(2 * this->jobs) {}
+
+    // returns the number of inputs that failed to load
+    unsigned run(const std::vector<std::string>& inputs, llvm::raw_ostream& o, llvm::raw_ostream& err) {
+        llvm::ThreadPool parsePool(jobs);
+        llvm::ThreadPool analysisPool(jobs);
+
+        std::deque<std::shared_future<std::shared_ptr<ParsedFile>>> inFlight;
+        size_t next = 0;
+        unsigned failed = 0;
+
+        auto submit = [&] {
+            auto task = std::make_shared<std::packaged_task<std::shared_ptr<ParsedFile>()>>(
+                    [this, &analysisPool, path = inputs[next++]] {
+                return parse(path, analysisPool);
+            });
+
+            inFlight.push_back(task->get_future().share());
+            parsePool.async([task] { (*task)(); });
+        };
+
+        for(size_t i = 0; i < inputs.size(); i++) {
+            while(next < inputs.size() && inFlight.size() < window) {
+                submit();
+            }
+
+            auto file = inFlight.front().get();
+            inFlight.pop_front();
+
+            if(inputs.size() > 1) {
+                o << "# " << inputs[i] << "\n";
+            }
+
+            if(!file->mod) {
+                err << inputs[i] << ": " << file->error << "\n";
+                failed++;
+                continue;
+            }
+
+            for(auto &function : file->functions) {
+                o << function.get();
+            }
+        }
+
+        return failed;
+    }
+
+    std::shared_ptr<ParsedFile> parse(const std::string& path, llvm::ThreadPool& analysisPool) const {
+        auto file = std::make_shared<ParsedFile>();
+
+        auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(path);
+        if(!buffer) {
+            file->error = buffer.getError().message();
+            return file;
+        }
+
+        file->ctx = std::make_unique<llvm::LLVMContext>();
+        file->mod = parseModule(buffer.get()->getMemBufferRef(), *file->ctx, file->error);
+        if(!file->mod) {
+            return file;
+        }
+
+        for(const auto& f : file->mod->getFunctionList()) {
+            if(f.isDeclaration()) {
+                continue;
+            }
+
+            // tasks keep the module alive through `file` until their output is produced
+            auto task = std::make_shared<std::packaged_task<std::string()>>([this, file, &f] {
+                std::string out;
+                llvm::raw_string_ostream o(out);
+                analyzeFunction(f, options, o);
+
+                return o.str();
+            });
+
+            file->functions.push_back(task->get_future().share());
+            analysisPool.async([task] { (*task)(); });
+        }
+
+        return file;
+    }
+};
+
+#endif //CODEPUNK_BATCHDRIVER_H
@@ -0,0 +1,287 @@
+#ifndef CODEPUNK_CONSTANTPROPAGATION_H
+#define CODEPUNK_CONSTANTPROPAGATION_H
+
+#include <llvm/ADT/APInt.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+// sparse conditional constant propagation over the SSA values of a function:
+// finds the edges that can be taken and the integer values that are the same on every execution.
+// values start out unknown and only move down to constant, then overdefined,
+// and a block is only looked at once an edge into it is known to be taken
+struct ConstantPropagation {
+    struct Lattice {
+        enum State : char { Unknown, Constant, Overdefined };
+
+        State state = Unknown;
+        llvm::APInt value = llvm::APInt();
+    };
+
+    using Edge = std::pair<const llvm::BasicBlock*, const llvm::BasicBlock*>;
+
+    std::map<const llvm::Value*, Lattice> values;
+    std::set<const llvm::BasicBlock*> blocks;
+    std::set<Edge> edges;
+
+    std::vector<const llvm::BasicBlock*> blockList;
+    std::vector<const llvm::Instruction*> instList;
+
+    explicit ConstantPropagation(const llvm::Function *f) {
+        markBlock(&f->getEntryBlock());
+
+        while(!blockList.empty() || !instList.empty()) {
+            while(!instList.empty()) {
+                auto inst = instList.back();
+                instList.pop_back();
+
+                if(blocks.count(inst->getParent())) {
+                    visit(inst);
+                }
+            }
+
+            while(!blockList.empty()) {
+                auto bb = blockList.back();
+                blockList.pop_back();
+
+                for(const auto &inst : *bb) {
+                    visit(&inst);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] bool isExecutable(const llvm::BasicBlock *bb) const {
+        return blocks.count(bb);
+    }
+
+    [[nodiscard]] bool isExecutable(const llvm::BasicBlock *from, const llvm::BasicBlock *to) const {
+        return edges.count({from, to});
+    }
+
+    // the value `v` has on every execution, null if there is none
+    [[nodiscard]] const llvm::APInt *constant(const llvm::Value *v) const {
+        if(auto iter = values.find(v); iter != values.end() && iter->second.state == Lattice::Constant) {
+            return &iter->second.value;
+        }
+
+        return nullptr;
+    }
+
+    Lattice get(const llvm::Value *v) const {
+        if(auto c = llvm::dyn_cast<llvm::ConstantInt>(v)) {
+            return {Lattice::Constant, c->getValue()};
+        }
+        if(llvm::isa<llvm::Constant>(v) || llvm::isa<llvm::Argument>(v)) {
+            return {Lattice::Overdefined};
+        }
+
+        if(auto iter = values.find(v); iter != values.end()) {
+            return iter->second;
+        }
+
+        return {};
+    }
+
+    void markBlock(const llvm::BasicBlock *bb) {
+        if(blocks.insert(bb).second) {
+            blockList.push_back(bb);
+        }
+    }
+
+    void markEdge(const llvm::BasicBlock *from, const llvm::BasicBlock *to) {
+        if(!edges.insert({from, to}).second) {
+            return;
+        }
+
+        if(blocks.count(to)) {
+            // only phis can tell a new edge into a block they have seen already
+            for(const auto &phi : to->phis()) {
+                instList.push_back(&phi);
+            }
+        }
+
+        markBlock(to);
+    }
+
+    void update(const llvm::Instruction *inst, const Lattice &val) {
+        auto &old = values[inst];
+        if(old.state == val.state && (val.state != Lattice::Constant || old.value == val.value)) {
+            return;
+        }
+
+        old = val;
+        for(auto user : inst->users()) {
+            instList.push_back(llvm::cast<llvm::Instruction>(user));
+        }
+    }
+
+    void visit(const llvm::Instruction *inst) {
+        if(inst->isTerminator()) {
+            visitTerminator(inst);
+            return;
+        }
+
+        if(inst->getType()->isVoidTy()) {
+            return;
+        }
+
+        update(inst, evaluate(inst));
+    }
+
+    void visitTerminator(const llvm::Instruction *inst) {
+        auto bb = inst->getParent();
+
+        if(auto br = llvm::dyn_cast<llvm::BranchInst>(inst); br && br->isConditional()) {
+            auto cond = get(br->getCondition());
+            if(cond.state == Lattice::Constant) {
+                markEdge(bb, br->getSuccessor(cond.value.getBoolValue() ? 0 : 1));
+            } else if(cond.state == Lattice::Overdefined) {
+                markEdge(bb, br->getSuccessor(0));
+                markEdge(bb, br->getSuccessor(1));
+            }
+            return;
+        }
+
+        if(auto sw = llvm::dyn_cast<llvm::SwitchInst>(inst)) {
+            auto cond = get(sw->getCondition());
+            if(cond.state == Lattice::Constant) {
+                auto taken = sw->case_default()->getCaseSuccessor();
+                for(const auto &c : sw->cases()) {
+                    if(c.getCaseValue()->getValue() == cond.value) {
+                        taken = c.getCaseSuccessor();
+                    }
+                }
+                markEdge(bb, taken);
+            } else if(cond.state == Lattice::Overdefined) {
+                for(auto succ : llvm::successors(bb)) {
+                    markEdge(bb, succ);
+                }
+            }
+            return;
+        }
+
+        for(auto succ : llvm::successors(bb)) {
+            markEdge(bb, succ);
+        }
+    }
+
+    Lattice evaluate(const llvm::Instruction *inst) {
+        const auto overdefined = Lattice{Lattice::Overdefined};
+
+        if(!inst->getType()->isIntegerTy()) {
+            return overdefined;
+        }
+
+        if(auto phi = llvm::dyn_cast<llvm::PHINode>(inst)) {
+            Lattice res;
+            for(unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+                if(!isExecutable(phi->getIncomingBlock(i), phi->getParent())) continue;
+
+                auto val = get(phi->getIncomingValue(i));
+                if(val.state == Lattice::Unknown) continue;
+                if(val.state == Lattice::Overdefined) return overdefined;
+
+                if(res.state == Lattice::Unknown) res = val;
+                else if(res.value != val.value) return overdefined;
+            }
+            return res;
+        }
+
+        switch (inst->getOpcode()) {
+            case llvm::Instruction::Add:
+            case llvm::Instruction::Sub:
+            case llvm::Instruction::Mul:
+            case llvm::Instruction::SDiv:
+            case llvm::Instruction::ICmp:
+            case llvm::Instruction::Select:
+            case llvm::Instruction::ZExt:
+            case llvm::Instruction::SExt:
+            case llvm::Instruction::Trunc:
+                break;
+            default:
+                return overdefined;
+        }
+
+        std::vector<llvm::APInt> operands;
+        bool unknown = false;
+        for(const auto &v : inst->operands()) {
+            auto val = get(v);
+            if(val.state == Lattice::Overdefined && !llvm::isa<llvm::SelectInst>(inst)) return overdefined;
+
+            unknown |= val.state == Lattice::Unknown;
+            operands.push_back(val.value);
+        }
+
+        if(auto select = llvm::dyn_cast<llvm::SelectInst>(inst)) {
+            auto cond = get(select->getCondition());
+            if(cond.state != Lattice::Constant) return cond.state == Lattice::Unknown ? Lattice{} : overdefined;
+
+            return get(cond.value.getBoolValue() ? select->getTrueValue() : select->getFalseValue());
+        }
+
+        if(unknown) {
+            return {};
+        }
+
+        const auto &l = operands[0];
+        switch (inst->getOpcode()) {
+            case llvm::Instruction::Add:
+                return {Lattice::Constant, l + operands[1]};
+            case llvm::Instruction::Sub:
+                return {Lattice::Constant, l - operands[1]};
+            case llvm::Instruction::Mul:
+                return {Lattice::Constant, l * operands[1]};
+            case llvm::Instruction::SDiv:
+                if(operands[1].isNullValue() || (l.isMinSignedValue() && operands[1].isAllOnesValue())) {
+                    return overdefined;
+                }
+                return {Lattice::Constant, l.sdiv(operands[1])};
+            case llvm::Instruction::ICmp:
+                return {Lattice::Constant, llvm::APInt(1, compare(
+                        llvm::cast<llvm::ICmpInst>(inst)->getPredicate(), l, operands[1]))};
+            case llvm::Instruction::ZExt:
+                return {Lattice::Constant, l.zext(inst->getType()->getIntegerBitWidth())};
+            case llvm::Instruction::SExt:
+                return {Lattice::Constant, l.sext(inst->getType()->getIntegerBitWidth())};
+            case llvm::Instruction::Trunc:
+                return {Lattice::Constant, l.trunc(inst->getType()->getIntegerBitWidth())};
+            default:
+                return overdefined;
+        }
+    }
+
+    static bool compare(llvm::CmpInst::Predicate p, const llvm::APInt &l, const llvm::APInt &r) {
+        switch (p) {
+            case llvm::CmpInst::ICMP_EQ:
+                return l == r;
+            case llvm::CmpInst::ICMP_NE:
+                return l != r;
+            case llvm::CmpInst::ICMP_UGT:
+                return l.ugt(r);
+            case llvm::CmpInst::ICMP_UGE:
+                return l.uge(r);
+            case llvm::CmpInst::ICMP_ULT:
+                return l.ult(r);
+            case llvm::CmpInst::ICMP_ULE:
+                return l.ule(r);
+            case llvm::CmpInst::ICMP_SGT:
+                return l.sgt(r);
+            case llvm::CmpInst::ICMP_SGE:
+                return l.sge(r);
+            case llvm::CmpInst::ICMP_SLT:
+                return l.slt(r);
+            case llvm::CmpInst::ICMP_SLE:
+                return l.sle(r);
+            default:
+                return false;
+        }
+    }
+};
+
+#endif //CODEPUNK_CONSTANTPROPAGATION_H
@@ -0,0 +1,198 @@
+#ifndef CODEPUNK_DAEMONPROTOCOL_H
+#define CODEPUNK_DAEMONPROTOCOL_H
+
+#include <Driver.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <optional>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+// wire format between codepunk-client and codepunkd over a unix domain socket:
+//
+//   request:  "codepunk/1\n", then "<key> <value>\n" lines ended by an empty line,
+//             followed by <size> bytes of IR or bitcode if an `inline <size>` line was sent
+//   response: one status byte ('0' for success, '1' for failure),
+//             then the analysis output (or the error message) until the connection is closed
+struct DaemonRequest {
+    static constexpr const char *Magic = "codepunk/1";
+
+    DriverOptions options;
+    std::string path;
+    std::string payload;
+    bool isInline = false;
+
+    [[nodiscard]] std::string encode() const {
+        std::string res = std::string(Magic) + "\n";
+
+        res += encodeOptions();
+        if(isInline) {
+            res += "inline " + std::to_string(payload.size()) + "\n\n" + payload;
+        } else {
+            res += "path " + path + "\n\n";
+        }
+
+        return res;
+    }
+
+    [[nodiscard]] std::string encodeOptions() const {
+        std::string res;
+
+        res += "iterate " + std::to_string(options.maxIteration) + "\n";
+        res += "checkpoint " + std::to_string(options.analysis.checkpointOnly) + "\n";
+        res += "tiered " + std::to_string(options.analysis.tiered) + "\n";
+        res += "accelerate " + std::to_string(options.analysis.accelerateLoops) + "\n";
+        res += "prune " + std::to_string(options.analysis.pruneDead) + "\n";
+        res += "budget-iterations " + std::to_string(options.analysis.iterationBudget) + "\n";
+        res += "budget-ms " + std::to_string(options.analysis.timeBudgetMs) + "\n";
+        res += "budget-memory " + std::to_string(options.analysis.memoryBudget) + "\n";
+        res += "domain " + std::to_string(int(options.domain)) + "\n";
+
+        return res;
+    }
+};
+
+struct SocketStream {
+    int fd;
+    std::string buffer;
+
+    explicit SocketStream(int fd) : fd(fd) {}
+
+    bool fill() {
+        char chunk[4096];
+
+        ssize_t n;
+        do {
+            n = ::read(fd, chunk, sizeof chunk);
+        } while(n < 0 && errno == EINTR);
+
+        if(n <= 0) {
+            return false;
+        }
+
+        buffer.append(chunk, n);
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        size_t pos;
+        while((pos = buffer.find('\n')) == std::string::npos) {
+            if(!fill()) return false;
+        }
+
+        line = buffer.substr(0, pos);
+        buffer.erase(0, pos + 1);
+        return true;
+    }
+
+    bool read(size_t size, std::string& out) {
+        while(buffer.size() < size) {
+            if(!fill()) return false;
+        }
+
+        out = buffer.substr(0, size);
+        buffer.erase(0, size);
+        return true;
+    }
+
+    bool readAll(std::string& out) {
+        while(fill());
+
+        out = std::move(buffer);
+        buffer.clear();
+        return true;
+    }
+
+    bool write(llvm::StringRef data) const {
+        while(!data.empty()) {
+            auto n = ::write(fd, data.data(), data.size());
+            if(n < 0) {
+                if(errno == EINTR) continue;
+                return false;
+            }
+
+            data = data.drop_front(n);
+        }
+
+        return true;
+    }
+
+    std::optional<DaemonRequest> readRequest() {
+        std::string line;
+        if(!readLine(line) || line != DaemonRequest::Magic) {
+            return std::nullopt;
+        }
+
+        DaemonRequest request;
+        size_t inlineSize = 0;
+
+        while(readLine(line) && !line.empty()) {
+            auto [key, value] = llvm::StringRef(line).split(' ');
+
+            if(key == "iterate") {
+                if(value.getAsInteger(10, request.options.maxIteration)) return std::nullopt;
+            } else if(key == "checkpoint") {
+                request.options.analysis.checkpointOnly = value == "1";
+            } else if(key == "tiered") {
+                request.options.analysis.tiered = value == "1";
+            } else if(key == "accelerate") {
+                request.options.analysis.accelerateLoops = value == "1";
+            } else if(key == "prune") {
+                request.options.analysis.pruneDead = value == "1";
+            } else if(key == "budget-iterations") {
+                if(value.getAsInteger(10, request.options.analysis.iterationBudget)) return std::nullopt;
+            } else if(key == "budget-ms") {
+                if(value.getAsInteger(10, request.options.analysis.timeBudgetMs)) return std::nullopt;
+            } else if(key == "budget-memory") {
+                if(value.getAsInteger(10, request.options.analysis.memoryBudget)) return std::nullopt;
+            } else if(key == "domain") {
+                int domain;
+                if(value.getAsInteger(10, domain) || domain < 0 || domain > int(AnalysisDomain::Sign)) return std::nullopt;
+                request.options.domain = AnalysisDomain(domain);
+            } else if(key == "path") {
+                request.path = value.str();
+            } else if(key == "inline") {
+                if(value.getAsInteger(10, inlineSize)) return std::nullopt;
+                request.isInline = true;
+            } else {
+                return std::nullopt;
+            }
+        }
+
+        if(request.isInline && !read(inlineSize, request.payload)) {
+            return std::nullopt;
+        }
+
+        return request;
+    }
+};
+
+inline bool makeSocketAddress(llvm::StringRef path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+
+    if(path.size() >= sizeof addr.sun_path) {
+        return false;
+    }
+
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return true;
+}
+
+// the default socket lives in a directory only its user can enter: $XDG_RUNTIME_DIR,
+// or else a directory of its own in /tmp, which codepunkd creates
+inline std::string defaultSocketPath() {
+    if(auto runtime = std::getenv("XDG_RUNTIME_DIR"); runtime && *runtime) {
+        return std::string(runtime) + "/codepunk.sock";
+    }
+
+    return "/tmp/codepunk-" + std::to_string(::getuid()) + "/codepunk.sock";
+}
+
+#endif //CODEPUNK_DAEMONPROTOCOL_H
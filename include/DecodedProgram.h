@@ -0,0 +1,257 @@
+#ifndef CODEPUNK_DECODEDPROGRAM_H
+#define CODEPUNK_DECODEDPROGRAM_H
+
+#include <ConstantPropagation.h>
+#include <InductionLoops.h>
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Operator.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+// the executable part of a function decoded once into assignments `to = l op r` over its values and integer slots,
+// with the executable edges of each block and the comparison its branch is refined by.
+// IntervalAnalysis and DomainAnalysis iterate the same program and only differ in what a constant operand is:
+// a `Constant` is made by the pool passed to decode, through its `constant(const APInt&)` and `top(unsigned width)`
+template <typename Constant>
+struct DecodedProgram {
+    // operand of a decoded instruction: `constant` if `value` is null, otherwise a value looked up
+    // in the block state, with `constant` the full range of its type for when the state has no entry for it
+    struct Operand {
+        const llvm::Value *value = nullptr;
+        Constant constant{};
+
+        bool operator==(const Operand&) const = default;
+    };
+
+    // loads, stores and allocas of integer slots all become Copy
+    struct Inst {
+        enum Opcode : char { Copy, Add, Sub, Mul, SDiv, ICmp };
+
+        Opcode opcode;
+        llvm::CmpInst::Predicate predicate = llvm::CmpInst::BAD_ICMP_PREDICATE;
+        bool nsw = false;
+        const llvm::Value *to;
+        Operand l, r;
+
+        bool operator==(const Inst&) const = default;
+    };
+
+    // conditional branch ending a block, with the integer comparison it is decided by if there is one
+    struct Branch {
+        const llvm::Value *cond = nullptr;
+        const llvm::BasicBlock *t = nullptr, *f = nullptr;
+
+        llvm::CmpInst::Predicate predicate = llvm::CmpInst::BAD_ICMP_PREDICATE;
+        const llvm::Value *l = nullptr, *r = nullptr;
+        Operand lOperand, rOperand;
+        const llvm::Value *lSlot = nullptr, *rSlot = nullptr;
+
+        [[nodiscard]] bool refined() const {
+            return isRefined(predicate);
+        }
+
+        bool operator==(const Branch&) const = default;
+    };
+
+    struct Block {
+        std::vector<Inst> insts;
+        std::vector<const llvm::BasicBlock*> preds, succs;
+        Branch branch;
+
+        bool operator==(const Block&) const = default;
+    };
+
+    using Blocks = std::map<const llvm::BasicBlock*, Block>;
+
+    // only the signed and equality predicates are evaluated and refined, the others are left unknown
+    static bool isRefined(llvm::CmpInst::Predicate p) {
+        return llvm::ICmpInst::isEquality(p) || llvm::ICmpInst::isSigned(p);
+    }
+
+    // integer allocas the analyses track, see InductionLoop::isSlot
+    static std::set<const llvm::Value*> findSlots(const llvm::Function *f) {
+        std::set<const llvm::Value*> found;
+        for(const auto &inst : llvm::instructions(f)) {
+            if(InductionLoop::isSlot(&inst)) {
+                found.insert(&inst);
+            }
+        }
+
+        return found;
+    }
+
+    // position of each reachable block in reverse post order
+    static std::map<const llvm::BasicBlock*, unsigned> order(const llvm::Function *f) {
+        std::map<const llvm::BasicBlock*, unsigned> found;
+        for(auto bb : llvm::ReversePostOrderTraversal<const llvm::Function*>(f)) {
+            found.emplace(bb, found.size());
+        }
+
+        return found;
+    }
+
+    // targets of the executable retreating edges in reverse post order
+    static std::set<const llvm::BasicBlock*> loopHeads(const llvm::Function *f, const Blocks &blocks) {
+        auto rpo = order(f);
+
+        std::set<const llvm::BasicBlock*> heads;
+        for(const auto &[bb, block] : blocks) {
+            for(auto succ : block.succs) {
+                if(rpo.count(bb) && rpo.at(succ) <= rpo.at(bb)) {
+                    heads.insert(succ);
+                }
+            }
+        }
+
+        return heads;
+    }
+
+    template <typename Pool>
+    static Operand operand(const llvm::Value *v, const ConstantPropagation &constants, Pool &&pool) {
+        auto width = v->getType()->getIntegerBitWidth();
+
+        if(auto c = llvm::dyn_cast<llvm::ConstantInt>(v)) {
+            return {nullptr, pool.constant(c->getValue())};
+        }
+        if(auto c = constants.constant(v)) {
+            return {nullptr, pool.constant(*c)};
+        }
+        if(llvm::isa<llvm::Constant>(v)) {
+            return {nullptr, pool.top(width)};
+        }
+
+        return {v, pool.top(width)};
+    }
+
+    template <typename Pool>
+    static Blocks decode(const llvm::Function *f, const ConstantPropagation &constants,
+            const std::set<const llvm::Value*> &slots, Pool &&pool) {
+        Blocks blocks;
+        for(const auto &bb : f->getBasicBlockList()) {
+            blocks.emplace(&bb, decode(&bb, constants, slots, pool));
+        }
+
+        return blocks;
+    }
+
+    template <typename Pool>
+    static Block decode(const llvm::BasicBlock *bb, const ConstantPropagation &constants,
+            const std::set<const llvm::Value*> &slots, Pool &&pool) {
+        Block block;
+        if(!constants.isExecutable(bb)) {
+            return block;
+        }
+
+        for(auto pred : llvm::predecessors(bb)) {
+            if(constants.isExecutable(pred, bb)) block.preds.push_back(pred);
+        }
+        for(auto succ : llvm::successors(bb)) {
+            if(constants.isExecutable(bb, succ)) block.succs.push_back(succ);
+        }
+
+        auto operandOf = [&](const llvm::Value *v) {
+            return operand(v, constants, pool);
+        };
+        auto unknown = [&](unsigned width) {
+            return Operand{nullptr, pool.top(width)};
+        };
+
+        for(const auto &inst : bb->getInstList()) {
+            auto ty = inst.getType();
+
+            if(constants.constant(&inst)) {
+                block.insts.push_back({Inst::Copy, {}, false, &inst, operandOf(&inst), {}});
+                continue;
+            }
+
+            switch (inst.getOpcode()) {
+                case llvm::Instruction::Alloca:
+                    if(slots.count(&inst)) {
+                        auto width = llvm::cast<llvm::AllocaInst>(inst).getAllocatedType()->getIntegerBitWidth();
+                        block.insts.push_back({Inst::Copy, {}, false, &inst, unknown(width), {}});
+                    }
+                    break;
+                case llvm::Instruction::Store: {
+                    auto from = inst.getOperand(0), to = inst.getOperand(1);
+                    if(from->getType()->isIntegerTy() && slots.count(to)) {
+                        block.insts.push_back({Inst::Copy, {}, false, to, operandOf(from), {}});
+                    }
+                    break;
+                }
+                case llvm::Instruction::Load:
+                    if(ty->isIntegerTy()) {
+                        auto from = inst.getOperand(0);
+                        auto l = unknown(ty->getIntegerBitWidth());
+                        if(slots.count(from)) {
+                            l.value = from;
+                        }
+                        block.insts.push_back({Inst::Copy, {}, false, &inst, l, {}});
+                    }
+                    break;
+                case llvm::Instruction::Add:
+                case llvm::Instruction::Sub:
+                case llvm::Instruction::Mul:
+                case llvm::Instruction::SDiv:
+                    if(ty->isIntegerTy()) {
+                        static const std::map<unsigned, typename Inst::Opcode> opcodes = {
+                                {llvm::Instruction::Add, Inst::Add}, {llvm::Instruction::Sub, Inst::Sub},
+                                {llvm::Instruction::Mul, Inst::Mul}, {llvm::Instruction::SDiv, Inst::SDiv}
+                        };
+
+                        bool nsw = llvm::isa<llvm::OverflowingBinaryOperator>(inst) &&
+                                llvm::cast<llvm::OverflowingBinaryOperator>(inst).hasNoSignedWrap();
+                        block.insts.push_back({opcodes.at(inst.getOpcode()), {}, nsw, &inst,
+                                operandOf(inst.getOperand(0)), operandOf(inst.getOperand(1))});
+                    }
+                    break;
+                case llvm::Instruction::ICmp: {
+                    const auto &cmpInst = llvm::cast<llvm::CmpInst>(inst);
+                    auto l = inst.getOperand(0), r = inst.getOperand(1);
+
+                    if(l->getType()->isIntegerTy() && isRefined(cmpInst.getPredicate())) {
+                        block.insts.push_back({Inst::ICmp, cmpInst.getPredicate(), false, &inst,
+                                operandOf(l), operandOf(r)});
+                    } else {
+                        block.insts.push_back({Inst::Copy, {}, false, &inst, unknown(1), {}});
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        if(auto br = llvm::dyn_cast<llvm::BranchInst>(bb->getTerminator()); br && br->isConditional()) {
+            auto &branch = block.branch;
+
+            branch.cond = br->getCondition();
+            branch.t = br->getSuccessor(0);
+            branch.f = br->getSuccessor(1);
+
+            if(auto cmpInst = llvm::dyn_cast<llvm::ICmpInst>(branch.cond);
+                cmpInst && cmpInst->getOperand(0)->getType()->isIntegerTy()) {
+                branch.predicate = cmpInst->getPredicate();
+                branch.l = cmpInst->getOperand(0);
+                branch.r = cmpInst->getOperand(1);
+                branch.lOperand = operandOf(branch.l);
+                branch.rOperand = operandOf(branch.r);
+
+                if(auto lLoad = llvm::dyn_cast<llvm::LoadInst>(branch.l); lLoad && slots.count(lLoad->getOperand(0))) {
+                    branch.lSlot = lLoad->getOperand(0);
+                }
+                if(auto rLoad = llvm::dyn_cast<llvm::LoadInst>(branch.r); rLoad && slots.count(rLoad->getOperand(0))) {
+                    branch.rSlot = rLoad->getOperand(0);
+                }
+            }
+        }
+
+        return block;
+    }
+};
+
+#endif //CODEPUNK_DECODEDPROGRAM_H
@@ -0,0 +1,256 @@
+#ifndef CODEPUNK_DOMAINANALYSIS_H
+#define CODEPUNK_DOMAINANALYSIS_H
+
+#include <DecodedProgram.h>
+#include <Domains.h>
+
+#include <map>
+#include <queue>
+#include <set>
+#include <vector>
+
+// the abstract domain an analysis runs in: IntervalAnalysis itself, or DomainAnalysis with one of the domains of Domains.h
+enum class AnalysisDomain : char { Interval, WidenedInterval, Constant, Sign };
+
+inline const char *domainName(AnalysisDomain domain) {
+    switch (domain) {
+        case AnalysisDomain::WidenedInterval:
+            return "interval-widen";
+        case AnalysisDomain::Constant:
+            return "constant";
+        case AnalysisDomain::Sign:
+            return "sign";
+        default:
+            return "interval";
+    }
+}
+
+struct DomainAnalysisOptions {
+    // times a loop head is iterated with plain joins before its state is widened
+    unsigned widenAfter = 2;
+};
+
+// worklist dataflow over the same decoded program as IntervalAnalysis (slots, SCCP-pruned edges, refined branches),
+// parametric in its abstract domain. the domain is a policy of static functions, so the transfer of an instruction
+// compiles down to the domain's own arithmetic. in place of closed-form loop evaluation, loop heads are widened.
+// IntervalAnalysis stays the full interval engine, this one is for cheaper screening domains
+template <typename Domain>
+struct DomainAnalysis {
+    using Value = typename Domain::Value;
+    using State = ArenaMap<const llvm::Value*, Value>;
+    using Symbols = std::map<const llvm::Value*, Value>;
+
+    // the decoded program of IntervalAnalysis, with domain values as the constant operands
+    using Decoded = DecodedProgram<Value>;
+    using Operand = typename Decoded::Operand;
+    using Inst = typename Decoded::Inst;
+    using Block = typename Decoded::Block;
+
+    // states live and die with the analysis
+    std::unique_ptr<Arena> arena = std::make_unique<Arena>();
+
+    DomainAnalysisOptions options;
+    const llvm::Function *function;
+    ConstantPropagation constants;
+
+    std::set<const llvm::Value*> slots;
+    typename Decoded::Blocks program;
+
+    // targets of retreating edges in reverse post order, with the number of times each was iterated
+    std::set<const llvm::BasicBlock*> heads;
+    std::map<const llvm::BasicBlock*, unsigned> visits;
+
+    ArenaMap<const llvm::BasicBlock*, State> dataMap{arena.get()};
+
+    // merged state on entry to each loop head, which is what gets widened: widening the state at its end
+    // would leave the comparisons of the head decided by the values from before widening
+    ArenaMap<const llvm::BasicBlock*, State> entries{arena.get()};
+    std::queue<const llvm::BasicBlock*> workList;
+    size_t iterations = 0;
+
+    explicit DomainAnalysis(const llvm::Function *f, const DomainAnalysisOptions &options = {})
+        : options(options), function(f), constants(f),
+          slots(Decoded::findSlots(f)), program(Decoded::decode(f, constants, slots, Domain{})),
+          heads(Decoded::loopHeads(f, program)) {
+        for(const auto &bb : f->getBasicBlockList()) {
+            dataMap.emplace(&bb, State(arena.get()));
+
+            if(constants.isExecutable(&bb)) {
+                workList.push(&bb);
+            }
+        }
+    }
+
+    void analyze(int maxIteration = -1) {
+        while(!workList.empty() && maxIteration != 0) {
+            iterate();
+            maxIteration--;
+        }
+    }
+
+    void iterate() {
+        auto bb = workList.front();
+        workList.pop();
+        iterations++;
+
+        const auto &block = program.at(bb);
+        auto &oldSymbols = dataMap.at(bb);
+
+        State merged(arena.get());
+        if(block.preds.empty()) {
+            seedArguments(merged);
+        }
+        for(auto pred : block.preds) {
+            edge(merged, pred, bb);
+        }
+
+        if(heads.count(bb)) {
+            auto &entry = entries.try_emplace(bb).first->second;
+            if(++visits[bb] > options.widenAfter) {
+                widen(entry, merged);
+            }
+            entry = merged;
+        }
+
+        auto newSymbols = transfer(bb, std::move(merged));
+
+        if(!equals(newSymbols, oldSymbols)) {
+            oldSymbols = std::move(newSymbols);
+            for(auto succBb : block.succs) {
+                workList.push(succBb);
+            }
+        }
+    }
+
+    // arguments enter the function unknown
+    void seedArguments(State &symbols) const {
+        for(const auto &arg : function->args()) {
+            if(arg.getType()->isIntegerTy()) {
+                symbols.emplace(&arg, Domain::top(arg.getType()->getIntegerBitWidth()));
+            }
+        }
+    }
+
+    static void join(State &symbols, const State &other) {
+        for(const auto &[v, value] : other) {
+            auto [iter, inserted] = symbols.emplace(v, value);
+            if(!inserted) {
+                iter->second = Domain::join(iter->second, value);
+            }
+        }
+    }
+
+    // widens `next` against the state `old` it replaces
+    static void widen(const State &old, State &next) {
+        for(auto &[v, value] : next) {
+            if(auto iter = old.find(v); iter != old.end()) {
+                value = Domain::widen(iter->second, value);
+            }
+        }
+    }
+
+    static bool equals(const State &a, const State &b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const auto &l, const auto &r) {
+            return l.first == r.first && Domain::equals(l.second, r.second);
+        });
+    }
+
+    // joins into `symbols` what flows along the edge from `bb` to `to`
+    void edge(State &symbols, const llvm::BasicBlock *bb, const llvm::BasicBlock *to) const {
+        const auto &branch = program.at(bb).branch;
+        const auto &bbSymbols = dataMap.at(bb);
+
+        auto condIter = branch.cond && branch.t != branch.f ? bbSymbols.find(branch.cond) : bbSymbols.end();
+        if(condIter == bbSymbols.end()) {
+            join(symbols, bbSymbols);
+            return;
+        }
+
+        // a decided condition only lets the state through the edge it takes
+        if(auto taken = Domain::truth(condIter->second)) {
+            if(to == (*taken ? branch.t : branch.f)) {
+                join(symbols, bbSymbols);
+            }
+            return;
+        }
+
+        if(!branch.refined()) {
+            join(symbols, bbSymbols);
+            return;
+        }
+
+        auto l = read(branch.lOperand, bbSymbols), r = read(branch.rOperand, bbSymbols);
+        Domain::refine(to == branch.t ? branch.predicate : llvm::CmpInst::getInversePredicate(branch.predicate), l, r);
+
+        // no value satisfies the condition on this edge
+        if(Domain::isBottom(l) || Domain::isBottom(r)) {
+            return;
+        }
+
+        auto refined = bbSymbols;
+        if(branch.lOperand.value) refined[branch.l] = l;
+        if(branch.rOperand.value) refined[branch.r] = r;
+        if(branch.lSlot) refined[branch.lSlot] = l;
+        if(branch.rSlot) refined[branch.rSlot] = r;
+
+        join(symbols, refined);
+    }
+
+    State transfer(const llvm::BasicBlock *bb, State symbols) const {
+        for(const auto &inst : program.at(bb).insts) {
+            execute(inst, symbols);
+        }
+
+        return symbols;
+    }
+
+    void execute(const Inst &inst, State &symbols) const {
+        const auto &l = read(inst.l, symbols);
+        if(inst.opcode == Inst::Copy) {
+            symbols[inst.to] = l;
+            return;
+        }
+
+        const auto &r = read(inst.r, symbols);
+        Value res;
+        switch (inst.opcode) {
+            case Inst::Add:
+                res = Domain::add(l, r, inst.nsw);
+                break;
+            case Inst::Sub:
+                res = Domain::sub(l, r, inst.nsw);
+                break;
+            case Inst::Mul:
+                res = Domain::mul(l, r, inst.nsw);
+                break;
+            case Inst::SDiv:
+                res = Domain::sdiv(l, r);
+                break;
+            case Inst::ICmp:
+                res = Domain::fromTernary(Domain::compare(inst.predicate, l, r));
+                break;
+            default:
+                break;
+        }
+
+        symbols[inst.to] = std::move(res);
+    }
+
+    static const Value &read(const Operand &operand, const State &symbols) {
+        if(operand.value) {
+            if(auto iter = symbols.find(operand.value); iter != symbols.end()) {
+                return iter->second;
+            }
+        }
+
+        return operand.constant;
+    }
+
+    // state at the end of `bb`
+    Symbols at(const llvm::BasicBlock *bb) const {
+        const auto &symbols = dataMap.at(bb);
+        return Symbols(symbols.begin(), symbols.end());
+    }
+};
+
+#endif //CODEPUNK_DOMAINANALYSIS_H
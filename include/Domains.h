@@ -0,0 +1,451 @@
+#ifndef CODEPUNK_DOMAINS_H
+#define CODEPUNK_DOMAINS_H
+
+#include <IntervalAnalysis.h>
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+// abstract domains for DomainAnalysis. a domain is a policy of static functions over its `Value`,
+// the abstraction of one integer, which the engine calls directly so that every kernel can be inlined:
+//
+//   top(width), constant(c)                the unknown and the known value of a type
+//   isBottom(v), equals(a, b)              no value at all (an infeasible path), and lattice equality
+//   join(a, b), meet(a, b)                 least upper and greatest lower bound
+//   widen(old, next)                       an upper bound of both that only finitely often grows
+//   add/sub/mul(l, r, nsw), sdiv(l, r)     transfer of the arithmetic, `nsw` if overflow is poison
+//   compare(p, l, r), fromTernary(t)       transfer of icmp, with the i1 value of its outcome
+//   truth(v)                               the outcome an i1 value decides, if any
+//   refine(p, l, r)                        narrows both operands to the values for which `l p r` holds
+//
+// only the signed and equality predicates reach compare and refine
+
+// flat lattice of single constants: the cheapest domain, it finds what constant folding through slots finds
+struct ConstantValue {
+    enum Kind : char { Bottom, Constant, Top };
+
+    Kind kind = Top;
+    // the constant, only its width for the other kinds
+    APInt c = APInt(1, 0);
+
+    friend llvm::raw_ostream &operator<<(llvm::raw_ostream &o, const ConstantValue &v) {
+        switch (v.kind) {
+            case Bottom:
+                return o << "bottom";
+            case Constant:
+                v.c.print(o, true);
+                return o;
+            default:
+                return o << "top";
+        }
+    }
+};
+
+struct ConstantDomain {
+    using Value = ConstantValue;
+    static constexpr const char *Name = "constant";
+
+    static Value top(unsigned width) {
+        return {Value::Top, APInt(width, 0)};
+    }
+
+    static Value constant(const APInt &c) {
+        return {Value::Constant, c};
+    }
+
+    static Value bottom(unsigned width) {
+        return {Value::Bottom, APInt(width, 0)};
+    }
+
+    static bool isBottom(const Value &v) {
+        return v.kind == Value::Bottom;
+    }
+
+    static bool equals(const Value &a, const Value &b) {
+        return a.kind == b.kind && (a.kind != Value::Constant || a.c == b.c);
+    }
+
+    static Value join(const Value &a, const Value &b) {
+        if(isBottom(a) || equals(a, b)) return b;
+        if(isBottom(b)) return a;
+        return top(a.c.getBitWidth());
+    }
+
+    static Value meet(const Value &a, const Value &b) {
+        if(a.kind == Value::Top || equals(a, b)) return b;
+        if(b.kind == Value::Top) return a;
+        return bottom(a.c.getBitWidth());
+    }
+
+    // chains are at most three values long
+    static Value widen(const Value &old, const Value &next) {
+        return join(old, next);
+    }
+
+    template <typename Op>
+    static Value binary(const Value &l, const Value &r, const Op &op) {
+        if(isBottom(l) || isBottom(r)) return bottom(l.c.getBitWidth());
+        if(l.kind == Value::Constant && r.kind == Value::Constant) return op(l.c, r.c);
+        return top(l.c.getBitWidth());
+    }
+
+    // constants wrap around exactly like the IR does
+    static Value add(const Value &l, const Value &r, bool) {
+        return binary(l, r, [](const APInt &a, const APInt &b) { return constant(a + b); });
+    }
+
+    static Value sub(const Value &l, const Value &r, bool) {
+        return binary(l, r, [](const APInt &a, const APInt &b) { return constant(a - b); });
+    }
+
+    static Value mul(const Value &l, const Value &r, bool) {
+        return binary(l, r, [](const APInt &a, const APInt &b) { return constant(a * b); });
+    }
+
+    static Value sdiv(const Value &l, const Value &r) {
+        return binary(l, r, [](const APInt &a, const APInt &b) {
+            // both are undefined in the IR
+            if(b.isNullValue() || (a.isMinSignedValue() && b.isAllOnesValue())) return top(a.getBitWidth());
+            return constant(a.sdiv(b));
+        });
+    }
+
+    static Ternary compare(llvm::CmpInst::Predicate p, const Value &l, const Value &r) {
+        if(l.kind != Value::Constant || r.kind != Value::Constant) {
+            return {};
+        }
+
+        switch (p) {
+            case llvm::CmpInst::ICMP_EQ:
+                return Ternary(l.c == r.c);
+            case llvm::CmpInst::ICMP_NE:
+                return Ternary(l.c != r.c);
+            case llvm::CmpInst::ICMP_SLT:
+                return Ternary(l.c.slt(r.c));
+            case llvm::CmpInst::ICMP_SLE:
+                return Ternary(l.c.sle(r.c));
+            case llvm::CmpInst::ICMP_SGT:
+                return Ternary(l.c.sgt(r.c));
+            case llvm::CmpInst::ICMP_SGE:
+                return Ternary(l.c.sge(r.c));
+            default:
+                return {};
+        }
+    }
+
+    static Value fromTernary(Ternary t) {
+        return t.v == Ternary::Unknown ? top(1) : constant(APInt(1, t.v == Ternary::True));
+    }
+
+    static std::optional<bool> truth(const Value &v) {
+        if(v.kind != Value::Constant) return std::nullopt;
+        return v.c.getBoolValue();
+    }
+
+    // only equality tells anything about single constants
+    static void refine(llvm::CmpInst::Predicate p, Value &l, Value &r) {
+        if(p == llvm::CmpInst::ICMP_EQ) {
+            l = r = meet(l, r);
+        } else if(p == llvm::CmpInst::ICMP_NE && l.kind == Value::Constant && equals(l, r)) {
+            l = r = bottom(l.c.getBitWidth());
+        }
+    }
+};
+
+// the signs a value may have, as a set of negative, zero and positive
+struct SignValue {
+    static constexpr uint8_t Negative = 1, Zero = 2, Positive = 4, All = 7;
+
+    uint8_t signs = All;
+
+    friend llvm::raw_ostream &operator<<(llvm::raw_ostream &o, const SignValue &v) {
+        o << "{";
+        if(v.signs & Negative) o << "-";
+        if(v.signs & Zero) o << "0";
+        if(v.signs & Positive) o << "+";
+        return o << "}";
+    }
+};
+
+// signs of values: a screening domain only a little more expensive than constants,
+// enough to prove values non-negative or non-zero. an i1 true is -1 as a signed value, so it is negative here
+struct SignDomain {
+    using Value = SignValue;
+    static constexpr const char *Name = "sign";
+
+    static Value top(unsigned) {
+        return {Value::All};
+    }
+
+    static Value constant(const APInt &c) {
+        return {c.isNegative() ? Value::Negative : c.isNullValue() ? Value::Zero : Value::Positive};
+    }
+
+    static bool isBottom(const Value &v) {
+        return !v.signs;
+    }
+
+    static bool equals(const Value &a, const Value &b) {
+        return a.signs == b.signs;
+    }
+
+    static Value join(const Value &a, const Value &b) {
+        return {uint8_t(a.signs | b.signs)};
+    }
+
+    static Value meet(const Value &a, const Value &b) {
+        return {uint8_t(a.signs & b.signs)};
+    }
+
+    static Value widen(const Value &old, const Value &next) {
+        return join(old, next);
+    }
+
+    // -1, 0 or 1 for a single sign
+    static int rank(uint8_t sign) {
+        return sign == Value::Negative ? -1 : sign == Value::Zero ? 0 : 1;
+    }
+
+    static int minRank(const Value &v) {
+        return v.signs & Value::Negative ? -1 : v.signs & Value::Zero ? 0 : 1;
+    }
+
+    static int maxRank(const Value &v) {
+        return v.signs & Value::Positive ? 1 : v.signs & Value::Zero ? 0 : -1;
+    }
+
+    // the union of `op` over every pair of signs of `l` and `r`
+    template <typename Op>
+    static Value pairwise(const Value &l, const Value &r, const Op &op) {
+        uint8_t res = 0;
+        for(uint8_t a : {Value::Negative, Value::Zero, Value::Positive}) {
+            for(uint8_t b : {Value::Negative, Value::Zero, Value::Positive}) {
+                if((l.signs & a) && (r.signs & b)) res |= op(rank(a), rank(b));
+            }
+        }
+
+        return {res};
+    }
+
+    static uint8_t signOf(int rank) {
+        return rank < 0 ? Value::Negative : rank == 0 ? Value::Zero : Value::Positive;
+    }
+
+    static Value add(const Value &l, const Value &r, bool nsw) {
+        return pairwise(l, r, [nsw](int a, int b) -> uint8_t {
+            if(a == 0 || b == 0) return signOf(a + b);
+            if(a != b) return Value::All;
+            // two positives wrap to a negative, two negatives to anything down to zero
+            if(nsw) return signOf(a);
+            return a > 0 ? Value::Positive | Value::Negative : Value::All;
+        });
+    }
+
+    static Value sub(const Value &l, const Value &r, bool nsw) {
+        return pairwise(l, r, [nsw](int a, int b) -> uint8_t {
+            if(b == 0) return signOf(a);
+            if(a == b) return Value::All;
+            // 0 - min and the differences of opposite signs may wrap, but never to zero
+            if(nsw) return signOf(a == 0 ? -b : a);
+            return a == 0 && b > 0 ? Value::Negative : Value::Positive | Value::Negative;
+        });
+    }
+
+    static Value mul(const Value &l, const Value &r, bool nsw) {
+        return pairwise(l, r, [nsw](int a, int b) -> uint8_t {
+            if(a == 0 || b == 0) return Value::Zero;
+            return nsw ? signOf(a * b) : Value::All;
+        });
+    }
+
+    // division by zero and min / -1 are undefined, the quotient otherwise rounds towards zero
+    static Value sdiv(const Value &l, const Value &r) {
+        return pairwise(l, r, [](int a, int b) -> uint8_t {
+            if(b == 0) return Value::All;
+            if(a == 0) return Value::Zero;
+            return signOf(a * b) | Value::Zero;
+        });
+    }
+
+    static Ternary compare(llvm::CmpInst::Predicate p, const Value &l, const Value &r) {
+        if(isBottom(l) || isBottom(r)) {
+            return {};
+        }
+
+        bool zeros = l.signs == Value::Zero && r.signs == Value::Zero;
+        switch (p) {
+            case llvm::CmpInst::ICMP_EQ:
+                if(zeros) return Ternary::True;
+                return l.signs & r.signs ? Ternary() : Ternary::False;
+            case llvm::CmpInst::ICMP_NE:
+                return !compare(llvm::CmpInst::ICMP_EQ, l, r);
+            case llvm::CmpInst::ICMP_SLT:
+                if(maxRank(l) < minRank(r)) return Ternary::True;
+                return minRank(l) > maxRank(r) || zeros ? Ternary::False : Ternary();
+            case llvm::CmpInst::ICMP_SLE:
+                if(maxRank(l) < minRank(r) || zeros) return Ternary::True;
+                return minRank(l) > maxRank(r) ? Ternary::False : Ternary();
+            case llvm::CmpInst::ICMP_SGT:
+                return compare(llvm::CmpInst::ICMP_SLT, r, l);
+            case llvm::CmpInst::ICMP_SGE:
+                return compare(llvm::CmpInst::ICMP_SLE, r, l);
+            default:
+                return {};
+        }
+    }
+
+    static Value fromTernary(Ternary t) {
+        switch (t.v) {
+            case Ternary::True:
+                return {Value::Negative};
+            case Ternary::False:
+                return {Value::Zero};
+            default:
+                return {Value::Negative | Value::Zero};
+        }
+    }
+
+    static std::optional<bool> truth(const Value &v) {
+        if(v.signs == Value::Zero) return false;
+        if(v.signs && !(v.signs & Value::Zero)) return true;
+        return std::nullopt;
+    }
+
+    // keeps the signs of `v` that can be below (or equal to, unless `strict`) a value of sign rank `bound`
+    static Value below(const Value &v, int bound, bool strict) {
+        uint8_t res = 0;
+        for(uint8_t s : {Value::Negative, Value::Zero, Value::Positive}) {
+            if((v.signs & s) && (rank(s) < bound || (rank(s) == bound && (!strict || s != Value::Zero)))) res |= s;
+        }
+
+        return {res};
+    }
+
+    static Value above(const Value &v, int bound, bool strict) {
+        uint8_t res = 0;
+        for(uint8_t s : {Value::Negative, Value::Zero, Value::Positive}) {
+            if((v.signs & s) && (rank(s) > bound || (rank(s) == bound && (!strict || s != Value::Zero)))) res |= s;
+        }
+
+        return {res};
+    }
+
+    static void refine(llvm::CmpInst::Predicate p, Value &l, Value &r) {
+        switch (p) {
+            case llvm::CmpInst::ICMP_EQ:
+                l = r = meet(l, r);
+                break;
+            case llvm::CmpInst::ICMP_NE:
+                if(r.signs == Value::Zero) l.signs &= uint8_t(~Value::Zero);
+                if(l.signs == Value::Zero) r.signs &= uint8_t(~Value::Zero);
+                break;
+            case llvm::CmpInst::ICMP_SLT:
+            case llvm::CmpInst::ICMP_SLE: {
+                bool strict = p == llvm::CmpInst::ICMP_SLT;
+                auto lMin = minRank(l), rMax = maxRank(r);
+                l = below(l, rMax, strict);
+                r = above(r, lMin, strict);
+                break;
+            }
+            case llvm::CmpInst::ICMP_SGT:
+            case llvm::CmpInst::ICMP_SGE:
+                refine(llvm::CmpInst::getSwappedPredicate(p), r, l);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+// the intervals of IntervalAnalysis, with widening at loop heads in place of closed-form loop evaluation
+struct IntervalDomain {
+    using Value = Interval;
+    static constexpr const char *Name = "interval";
+
+    static Value top(unsigned width) {
+        return Interval::full(width);
+    }
+
+    static Value constant(const APInt &c) {
+        return Interval(c);
+    }
+
+    static bool isBottom(const Value &v) {
+        return !v.isValid();
+    }
+
+    static bool equals(const Value &a, const Value &b) {
+        return a.equals(b);
+    }
+
+    static Value join(const Value &a, const Value &b) {
+        if(isBottom(a)) return b;
+        if(isBottom(b)) return a;
+        return a | b;
+    }
+
+    static Value meet(const Value &a, const Value &b) {
+        return a & b;
+    }
+
+    // a bound that moves at all moves to the end of the type
+    static Value widen(const Value &old, const Value &next) {
+        if(isBottom(old) || isBottom(next)) {
+            return join(old, next);
+        }
+
+        auto width = old.getLeft().getBitWidth();
+        return {next.getLeft() < old.getLeft() ? APSInt::getMinValue(width, false) : old.getLeft(),
+                next.getRight() > old.getRight() ? APSInt::getMaxValue(width, false) : old.getRight()};
+    }
+
+    // interval arithmetic already widens what may overflow
+    static Value add(const Value &l, const Value &r, bool) {
+        return l + r;
+    }
+
+    static Value sub(const Value &l, const Value &r, bool) {
+        return l - r;
+    }
+
+    static Value mul(const Value &l, const Value &r, bool) {
+        return l * r;
+    }
+
+    static Value sdiv(const Value &l, const Value &r) {
+        return l / r;
+    }
+
+    static Ternary compare(llvm::CmpInst::Predicate p, const Value &l, const Value &r) {
+        return IntervalAnalysis::compare(p, l, r);
+    }
+
+    static Value fromTernary(Ternary t) {
+        return IntervalAnalysis::fromTernary(t);
+    }
+
+    static std::optional<bool> truth(const Value &v) {
+        if(!v.isConstant()) return std::nullopt;
+        return v.getLeft().getBoolValue();
+    }
+
+    // the same solver IntervalAnalysis refines its branches with
+    static void refine(llvm::CmpInst::Predicate p, Value &l, Value &r) {
+        auto predicate = IntervalAnalysis::cmpInstToBoolExpr<int>(p);
+        if(predicate == BoolExpr<int>::Atomic) {
+            return;
+        }
+
+        auto symbols = std::make_shared<IntervalSymbols<int>>(IntervalSymbols<int>{{0, l}, {1, r}});
+        auto expr = std::make_shared<BinOp<int>>(predicate, std::make_shared<Atom<int>>(0), std::make_shared<Atom<int>>(1));
+
+        auto solved = IntervalSolver<int>{symbols, expr}.solve(true);
+        l = solved.at(0);
+        r = solved.at(1);
+    }
+};
+
+#endif //CODEPUNK_DOMAINS_H
@@ -0,0 +1,147 @@
+#ifndef CODEPUNK_DRIVER_H
+#define CODEPUNK_DRIVER_H
+
+#include <IntervalPrinter.h>
+#include <Transforms.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include <memory>
+#include <string>
+
+struct DriverOptions {
+    int maxIteration = -1;
+    IntervalAnalysisOptions analysis;
+
+    // the plain analysis runs in another domain than IntervalAnalysis, everything else always uses intervals
+    AnalysisDomain domain = AnalysisDomain::Interval;
+
+    // warn about functions whose analysis held more bytes than this at once, 0 to never warn
+    size_t memoryWarning = 0;
+};
+
+// parses textual IR or bitcode, leaves the diagnostic in `error` on failure
+inline std::unique_ptr<llvm::Module> parseModule(llvm::MemoryBufferRef buffer, llvm::LLVMContext& ctx,
+        std::string& error) {
+    llvm::SMDiagnostic diag;
+
+    auto mod = llvm::parseIR(buffer, diag, ctx);
+    if(!mod) {
+        error = diag.getMessage().str();
+    }
+
+    return mod;
+}
+
+// functions are analyzed in parallel, so the warning goes out in a single write
+inline void warnMemory(const llvm::Function& f, const IntervalAnalysis& analysis, size_t threshold,
+        llvm::raw_ostream& err) {
+    auto peak = analysis.memory->peakBytes();
+    if(!threshold || peak <= threshold) {
+        return;
+    }
+
+    std::string warning;
+    llvm::raw_string_ostream w(warning);
+    w << "warning: " << f.getName() << ": analysis held " << peak << " bytes (states "
+      << analysis.memory->peak(AnalysisMemory::States) << ", table " << analysis.memory->peak(AnalysisMemory::Table)
+      << "), over " << threshold << "\n";
+    err << w.str();
+}
+
+template <typename Domain>
+inline void analyzeFunctionIn(const llvm::Function& f, const DriverOptions& options, llvm::raw_ostream& o) {
+    DomainAnalysis<Domain> analysis(&f);
+    analysis.analyze(options.maxIteration);
+
+    printDomainAnalysis(o, &f, analysis);
+}
+
+inline void analyzeFunction(const llvm::Function& f, const DriverOptions& options, llvm::raw_ostream& o) {
+    switch (options.domain) {
+        case AnalysisDomain::WidenedInterval:
+            return analyzeFunctionIn<IntervalDomain>(f, options, o);
+        case AnalysisDomain::Constant:
+            return analyzeFunctionIn<ConstantDomain>(f, options, o);
+        case AnalysisDomain::Sign:
+            return analyzeFunctionIn<SignDomain>(f, options, o);
+        default:
+            break;
+    }
+
+    IntervalAnalysis analysis(&f, options.analysis);
+    analysis.analyze(options.maxIteration);
+
+    printIntervalAnalysis(o, &f, analysis);
+    warnMemory(f, analysis, options.memoryWarning, llvm::errs());
+}
+
+inline void analyzeModule(const llvm::Module& mod, const DriverOptions& options, llvm::raw_ostream& o) {
+    for(const auto& f : mod.getFunctionList()) {
+        if(f.isDeclaration()) {
+            continue;
+        }
+
+        analyzeFunction(f, options, o);
+    }
+}
+
+// writes a trip count record for every induction loop of `mod`, see printTripCounts
+inline void reportTripCounts(const llvm::Module& mod, const DriverOptions& options, llvm::json::OStream& o) {
+    for(const auto& f : mod.getFunctionList()) {
+        if(f.isDeclaration()) {
+            continue;
+        }
+
+        IntervalAnalysis analysis(&f, options.analysis);
+        analysis.analyze(options.maxIteration);
+
+        printTripCounts(o, f, tripCounts(f, analysis));
+    }
+}
+
+// writes a memory record for every function of `mod`: {"function", "iterations", ...}, see printAnalysisMemory
+inline void reportMemory(const llvm::Module& mod, const DriverOptions& options, llvm::json::OStream& o,
+        llvm::raw_ostream& err) {
+    for(const auto& f : mod.getFunctionList()) {
+        if(f.isDeclaration()) {
+            continue;
+        }
+
+        IntervalAnalysis analysis(&f, options.analysis);
+        analysis.analyze(options.maxIteration);
+
+        o.object([&] {
+            o.attribute("function", f.getName());
+            o.attribute("iterations", int64_t(analysis.iterations));
+            printAnalysisMemory(o, *analysis.memory);
+        });
+        warnMemory(f, analysis, options.memoryWarning, err);
+    }
+}
+
+// runs the transforms over every function of `mod`, returns the number of changes.
+// instructions are rewritten from the values around them, so states are never pruned here
+inline unsigned transformModule(llvm::Module& mod, const DriverOptions& options, const TransformOptions& transforms) {
+    auto analysisOptions = options.analysis;
+    analysisOptions.pruneDead = false;
+
+    unsigned changes = 0;
+    for(auto& f : mod.getFunctionList()) {
+        if(f.isDeclaration()) {
+            continue;
+        }
+
+        IntervalAnalysis analysis(&f, analysisOptions);
+        analysis.analyze(options.maxIteration);
+
+        changes += applyTransforms(f, analysis, transforms);
+    }
+
+    return changes;
+}
+
+#endif //CODEPUNK_DRIVER_H
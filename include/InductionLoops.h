@@ -0,0 +1,317 @@
+#ifndef CODEPUNK_INDUCTIONLOOPS_H
+#define CODEPUNK_INDUCTIONLOOPS_H
+
+#include <Interval.h>
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <set>
+#include <vector>
+
+// an innermost loop whose slots all move by a constant step per trip,
+// and which runs while the comparison in its header holds:
+//
+//   header: %l = load %lSlot; %r = load %rSlot; %c = icmp slt %l, %r; br %c, body, exit
+//   body:   %v = load %slot; %n = add %v, C; store %n, %slot; ...; br header
+//
+// either side of the comparison may also be a constant or a value from outside the loop
+struct InductionLoop {
+    const llvm::BasicBlock *header = nullptr;
+    std::vector<const llvm::BasicBlock*> entries, latches;
+    std::set<const llvm::BasicBlock*> body;
+
+    // step per trip of every slot stored in the loop
+    std::map<const llvm::Value*, APSInt> steps;
+
+    // the loop continues while `l predicate r`, predicate is ICMP_SLT or ICMP_SLE
+    llvm::CmpInst::Predicate predicate = llvm::CmpInst::ICMP_SLT;
+    const llvm::Value *l = nullptr, *r = nullptr;
+    const llvm::Value *lSlot = nullptr, *rSlot = nullptr;
+
+    // the header condition is the only way out of the loop
+    bool singleExit = true;
+
+    [[nodiscard]] APSInt stepOf(const llvm::Value *slot, unsigned width) const {
+        if(slot) {
+            if(auto iter = steps.find(slot); iter != steps.end()) {
+                return iter->second;
+            }
+        }
+
+        return APSInt(width, false);
+    }
+
+    // an integer alloca that is only ever loaded from and stored to as a whole,
+    // once its address escapes anything could change it behind the analysis' back
+    static bool isSlot(const llvm::Value *v) {
+        auto alloca = llvm::dyn_cast<llvm::AllocaInst>(v);
+        if(!alloca || !alloca->getAllocatedType()->isIntegerTy()) {
+            return false;
+        }
+
+        auto ty = alloca->getAllocatedType();
+        return std::all_of(alloca->user_begin(), alloca->user_end(), [alloca, ty](const llvm::User *user) {
+            if(auto load = llvm::dyn_cast<llvm::LoadInst>(user)) {
+                return !load->isVolatile() && load->getType() == ty;
+            }
+            if(auto store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+                return !store->isVolatile() && store->getPointerOperand() == alloca &&
+                    store->getValueOperand()->getType() == ty;
+            }
+            return false;
+        });
+    }
+
+    static std::map<const llvm::BasicBlock*, InductionLoop> find(const llvm::Function *f) {
+        std::map<const llvm::BasicBlock*, unsigned> order;
+        for(auto bb : llvm::ReversePostOrderTraversal<const llvm::Function*>(f)) {
+            order.emplace(bb, order.size());
+        }
+
+        auto isBackEdge = [&](const llvm::BasicBlock *from, const llvm::BasicBlock *to) {
+            auto iter = order.find(from);
+            return iter != order.end() && iter->second >= order.at(to);
+        };
+
+        std::map<const llvm::BasicBlock*, InductionLoop> loops;
+        for(const auto &[header, index] : order) {
+            InductionLoop loop;
+            loop.header = header;
+
+            for(auto pred : llvm::predecessors(header)) {
+                (isBackEdge(pred, header) ? loop.latches : loop.entries).push_back(pred);
+            }
+
+            if(!loop.latches.empty() && !loop.entries.empty() && loop.recognize(isBackEdge)) {
+                loops.emplace(header, std::move(loop));
+            }
+        }
+
+        return loops;
+    }
+
+    template <typename IsBackEdge>
+    bool recognize(const IsBackEdge& isBackEdge) {
+        body = {header};
+        std::vector<const llvm::BasicBlock*> stack(latches.begin(), latches.end());
+        while(!stack.empty()) {
+            auto bb = stack.back();
+            stack.pop_back();
+
+            if(body.insert(bb).second) {
+                stack.insert(stack.end(), llvm::pred_begin(bb), llvm::pred_end(bb));
+            }
+        }
+
+        // a single entry through the header and no inner loops
+        for(auto bb : body) {
+            if(bb == header) continue;
+
+            for(auto pred : llvm::predecessors(bb)) {
+                if(!body.count(pred) || isBackEdge(pred, bb)) return false;
+            }
+        }
+
+        for(auto bb : body) {
+            for(auto succ : llvm::successors(bb)) {
+                if(bb != header && !body.count(succ)) singleExit = false;
+            }
+        }
+
+        return recognizeCondition() && recognizeSteps();
+    }
+
+    bool recognizeCondition() {
+        auto br = llvm::dyn_cast<llvm::BranchInst>(header->getTerminator());
+        if(!br || !br->isConditional()) return false;
+
+        auto cmp = llvm::dyn_cast<llvm::ICmpInst>(br->getCondition());
+        if(!cmp || !cmp->getOperand(0)->getType()->isIntegerTy()) return false;
+
+        bool trueStays = body.count(br->getSuccessor(0)), falseStays = body.count(br->getSuccessor(1));
+        if(trueStays == falseStays) return false;
+
+        auto p = trueStays ? cmp->getPredicate() : cmp->getInversePredicate();
+        l = cmp->getOperand(0);
+        r = cmp->getOperand(1);
+
+        switch (p) {
+            case llvm::CmpInst::ICMP_SLT:
+            case llvm::CmpInst::ICMP_SLE:
+                predicate = p;
+                break;
+            case llvm::CmpInst::ICMP_SGT:
+            case llvm::CmpInst::ICMP_SGE:
+                predicate = llvm::CmpInst::getSwappedPredicate(p);
+                std::swap(l, r);
+                break;
+            default:
+                return false;
+        }
+
+        return recognizeOperand(l, lSlot) && recognizeOperand(r, rSlot);
+    }
+
+    // constants and values from outside the loop are invariant, loads in the header read the slot as the trip starts
+    bool recognizeOperand(const llvm::Value *v, const llvm::Value *&slot) const {
+        auto inst = llvm::dyn_cast<llvm::Instruction>(v);
+        if(!inst || !body.count(inst->getParent())) {
+            return true;
+        }
+
+        auto load = llvm::dyn_cast<llvm::LoadInst>(inst);
+        if(!load || load->getParent() != header || !isSlot(load->getPointerOperand())) {
+            return false;
+        }
+
+        slot = load->getPointerOperand();
+        return true;
+    }
+
+    bool recognizeSteps() {
+        std::map<const llvm::Value*, const llvm::StoreInst*> stores;
+
+        for(auto bb : body) {
+            for(const auto &inst : *bb) {
+                auto store = llvm::dyn_cast<llvm::StoreInst>(&inst);
+                if(!store || !isSlot(store->getPointerOperand())) continue;
+
+                if(bb == header || !stores.emplace(store->getPointerOperand(), store).second) {
+                    return false;
+                }
+            }
+        }
+
+        for(const auto &[slot, store] : stores) {
+            auto step = stepOf(store);
+            if(!step) return false;
+
+            // the trip count is derived assuming compared slots move on every trip
+            if((slot == lSlot || slot == rSlot) && !runsEveryTrip(store->getParent())) {
+                return false;
+            }
+
+            steps.emplace(slot, *step);
+        }
+
+        return true;
+    }
+
+    // matches `store (add (load slot), C), slot`, `add C, (load slot)` and `sub (load slot), C`,
+    // where the load reads the slot on the same trip. a load from before the loop is no step at all,
+    // and neither is one that another store to the slot can overwrite before this one
+    [[nodiscard]] std::optional<APSInt> stepOf(const llvm::StoreInst *store) const {
+        auto op = llvm::dyn_cast<llvm::BinaryOperator>(store->getValueOperand());
+        if(!op) return std::nullopt;
+
+        auto slot = store->getPointerOperand();
+        auto isSelf = [&](const llvm::Value *v) {
+            auto load = llvm::dyn_cast<llvm::LoadInst>(v);
+            return load && load->getPointerOperand() == slot && body.count(load->getParent()) &&
+                onlyStore(store);
+        };
+
+        auto l = op->getOperand(0), r = op->getOperand(1);
+        switch (op->getOpcode()) {
+            case llvm::Instruction::Add:
+                if(isSelf(r)) std::swap(l, r);
+                if(auto c = llvm::dyn_cast<llvm::ConstantInt>(r); c && isSelf(l)) {
+                    return APSInt(c->getValue(), false);
+                }
+                break;
+            case llvm::Instruction::Sub:
+                if(auto c = llvm::dyn_cast<llvm::ConstantInt>(r); c && isSelf(l)) {
+                    return APSInt(-c->getValue(), false);
+                }
+                break;
+            default:
+                break;
+        }
+
+        return std::nullopt;
+    }
+
+    // true if `store` is the only store to its slot in the loop. the load feeding it is in the loop
+    // and dominates it, so it then reads the value the slot has on the same trip up to the store
+    [[nodiscard]] bool onlyStore(const llvm::StoreInst *store) const {
+        for(auto bb : body) {
+            for(const auto &inst : *bb) {
+                auto other = llvm::dyn_cast<llvm::StoreInst>(&inst);
+                if(other && other != store && other->getPointerOperand() == store->getPointerOperand()) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // true if every path from the header back to it goes through `bb`
+    [[nodiscard]] bool runsEveryTrip(const llvm::BasicBlock *bb) const {
+        std::set<const llvm::BasicBlock*> seen{header, bb};
+        std::vector<const llvm::BasicBlock*> stack;
+
+        for(auto succ : llvm::successors(header)) {
+            if(succ == header) return false;
+            if(body.count(succ) && seen.insert(succ).second) stack.push_back(succ);
+        }
+
+        while(!stack.empty()) {
+            auto cur = stack.back();
+            stack.pop_back();
+
+            for(auto succ : llvm::successors(cur)) {
+                if(succ == header) return false;
+                if(body.count(succ) && seen.insert(succ).second) stack.push_back(succ);
+            }
+        }
+
+        return true;
+    }
+
+    // bounds on how many times the body runs, given the compared values as the loop is entered.
+    // the difference `r - l` moves by a constant each trip, the loop is only bounded when it shrinks.
+    // the result is {min, max}, min is only meaningful for a loop with a single exit
+    [[nodiscard]] std::optional<std::pair<APInt, APInt>> tripCount(const Interval &l0, const Interval &r0) const {
+        unsigned width = l0.getLeft().getBitWidth(), wide = 2 * width + 4;
+
+        auto delta = (stepOf(rSlot, width).extend(wide) - stepOf(lSlot, width).extend(wide));
+        if(!delta.isNegative()) {
+            return std::nullopt;
+        }
+
+        APInt threshold(wide, predicate == llvm::CmpInst::ICMP_SLT ? 1 : 0), speed = -delta;
+        auto trips = [&](const APInt &d) {
+            return d.sge(threshold) ? (d - threshold).udiv(speed) + 1 : APInt(wide, 0);
+        };
+
+        auto dMin = r0.getLeft().extend(wide) - l0.getRight().extend(wide);
+        auto dMax = r0.getRight().extend(wide) - l0.getLeft().extend(wide);
+
+        return std::make_pair(trips(dMin), trips(dMax));
+    }
+
+    // values a slot takes at the header over trips 0..maxTrips, starting from `v0`
+    [[nodiscard]] Interval closedForm(const llvm::Value *slot, const Interval &v0, const APInt &maxTrips) const {
+        unsigned width = v0.getLeft().getBitWidth(), wide = maxTrips.getBitWidth();
+
+        auto total = stepOf(slot, width).extend(wide) * APSInt(maxTrips, false);
+        auto zero = APSInt(wide, false);
+        auto lo = v0.getLeft().extend(wide) + std::min(zero, total);
+        auto hi = v0.getRight().extend(wide) + std::max(zero, total);
+
+        if(lo < APSInt::getMinValue(width, false).extend(wide) || hi > APSInt::getMaxValue(width, false).extend(wide)) {
+            return Interval::full(width);
+        }
+
+        return {lo.trunc(width), hi.trunc(width)};
+    }
+};
+
+#endif //CODEPUNK_INDUCTIONLOOPS_H
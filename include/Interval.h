@@ -84,21 +84,50 @@ public:
         return {std::min(a.l, b.l), std::max(a.r, b.r)};
     }
 
+    [[nodiscard]] static Interval full(unsigned width) {
+        return {APSInt::getMinValue(width, false), APSInt::getMaxValue(width, false)};
+    }
+
+    // arithmetic wraps around in the IR, so a bound that overflows may land anywhere in the type:
+    // such results are widened to the full range instead of wrapping into a bogus interval
+
     friend Interval operator+(const Interval& a, const Interval& b) {
-        return {a.l + b.l, a.r + b.r};
+        bool lo, ro;
+        APSInt l(a.l.sadd_ov(b.l, lo), false), r(a.r.sadd_ov(b.r, ro), false);
+
+        if(lo || ro) return full(a.l.getBitWidth());
+        return {l, r};
     }
 
     friend Interval operator-(const Interval& a, const Interval& b) {
-        return {a.l - b.r, a.r - b.l};
+        bool lo, ro;
+        APSInt l(a.l.ssub_ov(b.r, lo), false), r(a.r.ssub_ov(b.l, ro), false);
+
+        if(lo || ro) return full(a.l.getBitWidth());
+        return {l, r};
     }
 
     friend Interval operator*(const Interval& a, const Interval& b) {
-        auto list = {a.l*b.l, a.l*b.r, a.r*b.l, a.r*b.r};
+        bool o[4];
+        auto list = {
+                APSInt(a.l.smul_ov(b.l, o[0]), false), APSInt(a.l.smul_ov(b.r, o[1]), false),
+                APSInt(a.r.smul_ov(b.l, o[2]), false), APSInt(a.r.smul_ov(b.r, o[3]), false)};
+
+        if(o[0] || o[1] || o[2] || o[3]) return full(a.l.getBitWidth());
         return {std::min(list), std::max(list)};
     }
 
     friend Interval operator/(const Interval& a, const Interval& b) {
-        auto list = {a.l/b.l, a.l/b.r, a.r/b.l, a.r/b.r};
+        if(b.contains(APSInt(APInt::getNullValue(b.l.getBitWidth()), false))) {
+            return full(a.l.getBitWidth());
+        }
+
+        bool o[4];
+        auto list = {
+                APSInt(a.l.sdiv_ov(b.l, o[0]), false), APSInt(a.l.sdiv_ov(b.r, o[1]), false),
+                APSInt(a.r.sdiv_ov(b.l, o[2]), false), APSInt(a.r.sdiv_ov(b.r, o[3]), false)};
+
+        if(o[0] || o[1] || o[2] || o[3]) return full(a.l.getBitWidth());
         return {std::min(list), std::max(list)};
     }
 
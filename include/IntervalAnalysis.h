@@ -5,116 +5,736 @@
 #ifndef CODEPUNK_INTERVALANALYSIS_H
 #define CODEPUNK_INTERVALANALYSIS_H
 
+#include <AnalysisMemory.h>
+#include <ConstantPropagation.h>
+#include <DecodedProgram.h>
+#include <InductionLoops.h>
 #include <IntervalSolver.h>
+#include <IntervalTable.h>
+#include <llvm/ADT/PostOrderIterator.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/InstIterator.h>
+#include <llvm/IR/Instructions.h>
 
+#include <algorithm>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <queue>
 #include <numeric>
+#include <set>
+#include <vector>
+
+struct IntervalAnalysisOptions {
+    // store block states only at checkpoints (entry, join points and loop heads, exits),
+    // the others are replayed from the closest checkpoint when they are needed
+    bool checkpointOnly = false;
+
+    // settle loop-free functions whose branches are all decided by a single pass in reverse post order,
+    // falling back to the full fixpoint for everything else
+    bool tiered = false;
+
+    // per-function budgets, 0 for unlimited. when one is exhausted the blocks still to converge
+    // are widened to the full range of their types, so the analysis finishes quickly and stays sound
+    unsigned iterationBudget = 0;
+    unsigned timeBudgetMs = 0;
+    size_t memoryBudget = 0;
+
+    // heads of simple induction loops take the values of their induction slots over all trips at once,
+    // computed in closed form from the state on entry, instead of stepping through the trips one by one
+    bool accelerateLoops = true;
+
+    // drop values from block states once no later instruction or branch reads them,
+    // the output then only shows the values still live at the end of each block
+    bool pruneDead = false;
+};
 
 struct IntervalAnalysis {
     using Symbols = IntervalSymbols<const llvm::Value*>;
+    using State = IdSymbols<const llvm::Value*>;
+    using Expr = BoolExpr<const llvm::Value*>;
+
+    // the decoded program, with operands that are not looked up in the state pointing into the constant pool
+    using Decoded = DecodedProgram<unsigned>;
+    using Operand = Decoded::Operand;
+    using Inst = Decoded::Inst;
+    using Branch = Decoded::Branch;
+    using Block = Decoded::Block;
+
+    // an induction loop with the operands of its exit comparison
+    struct Accelerated {
+        InductionLoop loop;
+        Operand l, r;
+    };
+
+    // states and the interval table are allocated from its arena and freed together with the analysis,
+    // each through the counter of its subsystem. held by pointer so that containers keep a valid resource
+    // when the analysis is moved
+    std::unique_ptr<AnalysisMemory> memory = std::make_unique<AnalysisMemory>();
+
+    // every interval of the analysis, states only hold ids into it.
+    // const readers replay states too, which may intern the intervals they compute
+    mutable IntervalTable table{&memory->table, &memory->wide};
+
+    // only ever grows, shared by all block states. indexed by the interned interval rather than by the value,
+    // so that no entry outlives an instruction deleted by an edit and turns up for another one at its address
+    std::vector<IntervalTable::Id> constantPool;
+    std::map<IntervalTable::Id, unsigned> constantIndex;
+    std::map<unsigned, unsigned> topIndex;
+
+    IntervalAnalysisOptions options;
+    const llvm::Function *function;
+
+    // executable edges and constant values, only the executable part of the function is decoded and iterated
+    ConstantPropagation constants;
 
-    std::map<const llvm::BasicBlock*, Symbols> dataMap;
+    // 0 before analyzing, 1 if the triage pass was enough, 2 if the full fixpoint ran
+    int tier = 0;
+
+    enum Budget { None, Iteration, Time, Memory };
+
+    Budget exhausted = None;
+    size_t iterations = 0;
+    size_t stateEntries = 0;
+    std::chrono::steady_clock::time_point start;
+
+    // integer allocas the analysis tracks, see InductionLoop::isSlot
+    std::set<const llvm::Value*> slots;
+
+    Decoded::Blocks program;
+    std::map<const llvm::BasicBlock*, Accelerated> loops;
+
+    // values kept at the end of each block when pruning: those live out of it and those its branch reads
+    std::map<const llvm::BasicBlock*, std::set<const llvm::Value*>> live;
+
+    ArenaMap<const llvm::BasicBlock*, State> dataMap{&memory->states};
     std::queue<const llvm::BasicBlock*> workList;
 
-    explicit IntervalAnalysis(const llvm::Function* f) {
-        for(const auto &bb : f->getBasicBlockList()) {
-            dataMap.emplace(&bb, Symbols{});
-            workList.push(&bb);
+    // blocks edited since the last run, see markEdited
+    std::set<const llvm::BasicBlock*> edited;
+
+    // blocks whose stored state changed since it was last written to a snapshot, see Snapshot.h
+    std::set<const llvm::BasicBlock*> dirty;
+
+    explicit IntervalAnalysis(const llvm::Function* f, const IntervalAnalysisOptions& options = {})
+        : options(options), function(f), constants(f) {
+        slots = findSlots();
+        program = Decoded::decode(f, constants, slots, *this);
+
+        findLoops();
+
+        if(options.pruneDead) {
+            computeLiveness();
+        }
+
+        placeCheckpoints(f);
+        reset();
+
+        memory->endPhase(AnalysisMemory::Decode);
+    }
+
+    [[nodiscard]] std::set<const llvm::Value*> findSlots() const {
+        return Decoded::findSlots(function);
+    }
+
+    void findLoops() {
+        loops.clear();
+        if(!options.accelerateLoops) {
+            return;
+        }
+
+        for(auto &[header, loop] : InductionLoop::find(function)) {
+            auto l = operand(loop.l), r = operand(loop.r);
+            loops.emplace(header, Accelerated{std::move(loop), l, r});
+        }
+    }
+
+    // marks `bb` as edited in place: instructions were changed, inserted into it or deleted from it.
+    // the next analyze() re-decodes the function and only re-runs the blocks whose state can depend on an edit,
+    // starting from the states of the others. blocks have to be reported before their instructions are deleted
+    void markEdited(const llvm::BasicBlock *bb) {
+        edited.insert(bb);
+    }
+
+    void markEdited(const llvm::Instruction *inst) {
+        markEdited(inst->getParent());
+    }
+
+    // brings the decoded program up to date with the edits and drops the states they reach.
+    // anything beyond edits inside blocks, like new blocks, edges or slots, starts the analysis over
+    void revalidate() {
+        if(edited.empty()) {
+            return;
+        }
+
+        std::set<const llvm::BasicBlock*> changed;
+        changed.swap(edited);
+
+        // a degraded result was computed under budgets that no longer hold
+        if(exhausted != None || function->size() != program.size() || findSlots() != slots) {
+            rebuild();
+            return;
+        }
+
+        // constants and executable edges of unedited blocks can change too, so the whole function is decoded again
+        constants = ConstantPropagation(function);
+
+        Decoded::Blocks decoded;
+        for(const auto &bb : function->getBasicBlockList()) {
+            auto iter = program.find(&bb);
+            if(iter == program.end()) {
+                rebuild();
+                return;
+            }
+
+            auto block = Decoded::decode(&bb, constants, slots, *this);
+            if(block.preds != iter->second.preds || block.succs != iter->second.succs) {
+                rebuild();
+                return;
+            }
+            if(!(block == iter->second)) {
+                changed.insert(&bb);
+            }
+
+            decoded.emplace(&bb, std::move(block));
+        }
+
+        program = std::move(decoded);
+        findLoops();
+
+        if(options.pruneDead) {
+            auto oldLive = std::move(live);
+            live.clear();
+            computeLiveness();
+            for(const auto &[bb, keep] : live) {
+                if(oldLive[bb] != keep) changed.insert(bb);
+            }
+        }
+
+        // a state only depends on the states before it, so only the blocks an edit reaches can change
+        std::set<const llvm::BasicBlock*> reached;
+        std::vector<const llvm::BasicBlock*> stack(changed.begin(), changed.end());
+        while(!stack.empty()) {
+            auto bb = stack.back();
+            stack.pop_back();
+
+            if(reached.insert(bb).second) {
+                const auto &succs = program.at(bb).succs;
+                stack.insert(stack.end(), succs.begin(), succs.end());
+            }
+        }
+
+        workList = {};
+        for(auto bb : llvm::ReversePostOrderTraversal<const llvm::Function*>(function)) {
+            if(!reached.count(bb)) {
+                continue;
+            }
+
+            if(auto iter = dataMap.find(bb); iter != dataMap.end()) {
+                stateEntries -= iter->second.size();
+                iter->second.clear();
+                dirty.insert(bb);
+                if(bb == &function->getEntryBlock()) {
+                    seedArguments();
+                }
+            }
+
+            if(constants.isExecutable(bb)) {
+                workList.push(bb);
+            }
         }
 
-        auto &entrySymbols = dataMap.at(&f->getEntryBlock());
-        for(const auto& i : f->args()) {
+        iterations = 0;
+    }
+
+    // starts over on the function as it is now
+    void rebuild() {
+        slots = findSlots();
+        constants = ConstantPropagation(function);
+
+        dataMap.clear();
+        dirty.clear();
+        program = Decoded::decode(function, constants, slots, *this);
+
+        findLoops();
+
+        live.clear();
+        if(options.pruneDead) {
+            computeLiveness();
+        }
+
+        placeCheckpoints(function);
+
+        tier = 0;
+        exhausted = None;
+        iterations = 0;
+        reset();
+    }
+
+    // drops all states and schedules every block again
+    void reset() {
+        for(auto &[bb, symbols] : dataMap) {
+            symbols.clear();
+            dirty.insert(bb);
+        }
+        stateEntries = 0;
+
+        workList = {};
+        for(const auto &bb : function->getBasicBlockList()) {
+            if(constants.isExecutable(&bb)) {
+                workList.push(&bb);
+            }
+        }
+
+        seedArguments();
+    }
+
+    // arguments enter the function with the full range of their type
+    void seedArguments() {
+        auto &entrySymbols = dataMap.at(&function->getEntryBlock());
+        dirty.insert(&function->getEntryBlock());
+        for(const auto& i : function->args()) {
             auto ty = i.getType();
             if(ty->isIntegerTy()) {
-                entrySymbols.emplace((llvm::Value*)&i, Interval(
-                        APSInt::getMinValue(ty->getIntegerBitWidth(), false),
-                        APSInt::getMaxValue(ty->getIntegerBitWidth(), false)));
+                entrySymbols.emplace(&i, constantPool[top(ty->getIntegerBitWidth())]);
             }
         }
+        stateEntries += entrySymbols.size();
     }
 
     void analyze(int maxIteration = -1) {
+        if(!edited.empty()) {
+            revalidate();
+            memory->endPhase(AnalysisMemory::Decode);
+        }
+
+        if(iterations == 0) {
+            start = std::chrono::steady_clock::now();
+        }
+
+        if(options.tiered && tier == 0) {
+            tier = triage() ? 1 : 2;
+            if(tier == 2) {
+                reset();
+            }
+            memory->endPhase(AnalysisMemory::Triage);
+        }
+
         while(!workList.empty() && maxIteration != 0) {
+            if(exhausted == None) {
+                exhausted = checkBudget();
+            }
+
             iterate();
             maxIteration--;
         }
+        memory->endPhase(AnalysisMemory::Fixpoint);
+    }
+
+    // rough footprint of the stored states: one map node per entry
+    static constexpr size_t EntryBytes = sizeof(State::value_type) + 4 * sizeof(void*);
+
+    [[nodiscard]] Budget checkBudget() const {
+        if(options.iterationBudget && iterations >= options.iterationBudget) {
+            return Iteration;
+        }
+        if(options.memoryBudget && stateEntries * EntryBytes > options.memoryBudget) {
+            return Memory;
+        }
+        if(options.timeBudgetMs && std::chrono::steady_clock::now() - start >
+            std::chrono::milliseconds(options.timeBudgetMs)) {
+            return Time;
+        }
+
+        return None;
+    }
+
+    static const char *budgetName(Budget budget) {
+        switch (budget) {
+            case Iteration:
+                return "iteration";
+            case Time:
+                return "time";
+            case Memory:
+                return "memory";
+            default:
+                return "none";
+        }
     }
 
     void iterate() {
         auto bb = workList.front();
         workList.pop();
+        iterations++;
+
+        const auto &block = program.at(bb);
+
+        // blocks without a stored state are replayed on demand, so all that is left is to
+        // tell their successors that the predecessor they are replayed from has changed
+        if(!dataMap.count(bb)) {
+            for(auto succBb : block.succs) {
+                workList.push(succBb);
+            }
+            return;
+        }
 
         auto oldSymbols = dataMap.at(bb);
 
         auto mergedSymbols = oldSymbols;
-        if(bb->hasNPredecessorsOrMore(1)) {
-            mergedSymbols = merge(std::vector<const llvm::BasicBlock *>{
-                llvm::pred_begin(bb), llvm::pred_end(bb)}, bb);
+        if(!block.preds.empty()) {
+            mergedSymbols = merge(block.preds, bb, exhausted == None);
+        }
+
+        if(auto iter = loops.find(bb); iter != loops.end() && exhausted == None) {
+            accelerate(iter->second, mergedSymbols);
+        }
+
+        // out of budget: everything reaching this block from now on is taken as unknown,
+        // states then only change when new values show up, which bounds the remaining iterations
+        if(exhausted != None) {
+            for(auto &[v, id] : mergedSymbols) {
+                id = constantPool[top(table[id].getLeft().getBitWidth())];
+            }
         }
 
         auto newSymbols = transfer(bb, mergedSymbols);
+        prune(bb, newSymbols);
+        stateEntries += newSymbols.size() - oldSymbols.size();
         dataMap.at(bb) = newSymbols;
 
-        if(newSymbols != oldSymbols) {
-            for(auto succBb : llvm::successors(bb)) {
+        if(!newSymbols.equals(oldSymbols)) {
+            dirty.insert(bb);
+            for(auto succBb : block.succs) {
                 workList.push(succBb);
             }
         }
     }
 
-    Symbols merge(const std::vector<const llvm::BasicBlock*>& vec, const llvm::BasicBlock *to) {
-        return std::accumulate(vec.begin(), vec.end(), Symbols{}, [this, to](
-                const Symbols& symbols, const llvm::BasicBlock* bb) {
-            auto bbSymbols = dataMap.at(bb), newSymbols = symbols | bbSymbols;
-            auto term = bb->getTerminator();
+    // overrides the induction slots merged at a loop head with every value they take there,
+    // which the trips through the loop can then only confirm. that only holds while the compared slots stay
+    // in range: once one may wrap around the trip count is wrong, and the slots are joined with their full range.
+    // in range the closed form already holds every value of the header, joining it with what the latches bring
+    // would only add what the non-relational refinement lets through, one step per iteration, and never converge
+    void accelerate(const Accelerated &accelerated, State &merged) const {
+        const auto &loop = accelerated.loop;
+        auto entry = merge(loop.entries, loop.header);
+
+        if((loop.lSlot && !entry.count(loop.lSlot)) || (loop.rSlot && !entry.count(loop.rSlot))) {
+            return;
+        }
+
+        auto l0 = table[loop.lSlot ? entry.at(loop.lSlot) : read(accelerated.l, entry)];
+        auto r0 = table[loop.rSlot ? entry.at(loop.rSlot) : read(accelerated.r, entry)];
+        if(!l0.isValid() || !r0.isValid()) {
+            return;
+        }
+
+        auto trips = loop.tripCount(l0, r0);
+        if(!trips) {
+            return;
+        }
+
+        auto wraps = [&](const llvm::Value *slot, const Interval &v0) {
+            auto width = v0.getLeft().getBitWidth();
+            return slot && !loop.stepOf(slot, width).isNullValue() &&
+                loop.closedForm(slot, v0, trips->second).equals(topOf(width));
+        };
+        bool wrapped = wraps(loop.lSlot, l0) || wraps(loop.rSlot, r0);
+
+        for(const auto &[slot, step] : loop.steps) {
+            if(auto iter = entry.find(slot); iter != entry.end()) {
+                const auto &v0 = table[iter->second];
+                merged[slot] = table.intern(wrapped ? topOf(v0.getLeft().getBitWidth())
+                                                    : loop.closedForm(slot, v0, trips->second));
+            }
+        }
+    }
+
+    // tier one: a single pass in reverse post order without path refinement.
+    // on a loop-free function every block is visited after all its (reachable) predecessors,
+    // and refinement only ever applies to undecided branch conditions,
+    // so if none are met the result is the fixpoint itself.
+    // returns false as soon as a back edge or an undecided refinable branch shows up
+    bool triage() {
+        auto order = Decoded::order(function);
+
+        for(auto bb : llvm::ReversePostOrderTraversal<const llvm::Function*>(function)) {
+            if(!constants.isExecutable(bb)) {
+                continue;
+            }
 
-            if(term->getOpcode() == llvm::Instruction::Br && term->getNumOperands() >= 3) {
-                auto cond = term->getOperand(0), t = term->getOperand(1), f = term->getOperand(2);
+            const auto &block = program.at(bb);
 
-                auto condVal = bbSymbols.at(cond);
-                if(condVal.equals(APSInt(1, false))) {
-                    newSymbols = symbols;
+            State merged = block.preds.empty() ? dataMap.at(bb) : newState();
+            for(auto pred : block.preds) {
+                auto iter = order.find(pred);
+                if(iter == order.end()) {
+                    continue;
                 }
-                else if(condVal.length() != 0) {
-                    if(auto cmpInst = llvm::dyn_cast<llvm::CmpInst>(cond)) {
-                        auto l = cmpInst->getOperand(0), r = cmpInst->getOperand(1);
-                        auto pred = cmpInstToBoolExpr<const llvm::Value*>(cmpInst->getPredicate());
-
-                        if(pred != BoolExpr<const llvm::Value*>::Atomic) {
-                            auto condExpr = std::make_shared<BinOp<const llvm::Value *>>(
-                                    pred,
-                                    std::make_shared<Atom<const llvm::Value *>>(l),
-                                    std::make_shared<Atom<const llvm::Value *>>(r));
-
-                            IntervalSolver<const llvm::Value *> solver{
-                                    std::make_shared<IntervalSymbols<const llvm::Value *>>(bbSymbols), condExpr};
-
-                            auto solvedSymbols = solver.solve(t != to);
-
-                            if(auto lLoad = llvm::dyn_cast<llvm::Instruction>(l);
-                                lLoad && lLoad->getOpcode() == llvm::Instruction::Load) {
-                                auto lLFrom = lLoad->getOperand(0), lLTo = (llvm::Value*)lLoad;
-                                solvedSymbols.at(lLFrom) = solvedSymbols.at(lLTo);
-                            }
-                            if(auto rLoad = llvm::dyn_cast<llvm::Instruction>(r);
-                                    rLoad && rLoad->getOpcode() == llvm::Instruction::Load) {
-                                auto rLFrom = rLoad->getOperand(0), rLTo = (llvm::Value*)rLoad;
-                                solvedSymbols.at(rLFrom) = solvedSymbols.at(rLTo);
-                            }
-
-                            newSymbols = symbols | solvedSymbols;
-                        }
-                    }
+                if(iter->second >= order.at(bb)) {
+                    return false;
                 }
+
+                State replayed = newState();
+                merged = edge(merged, pred, state(pred, replayed), bb, false);
             }
 
-            return newSymbols;
+            auto newSymbols = transfer(bb, merged);
+
+            const auto &branch = block.branch;
+            if(branch.cond && branch.refined() && branch.t != branch.f) {
+                if(auto iter = newSymbols.find(branch.cond); iter != newSymbols.end() && table[iter->second].length() != 0) {
+                    return false;
+                }
+            }
+
+            prune(bb, newSymbols);
+
+            if(auto iter = dataMap.find(bb); iter != dataMap.end()) {
+                stateEntries += newSymbols.size() - iter->second.size();
+                iter->second = std::move(newSymbols);
+                dirty.insert(bb);
+            }
+        }
+
+        workList = {};
+        return true;
+    }
+
+    [[nodiscard]] State newState() const {
+        return State(&memory->states);
+    }
+
+    // state at the end of `bb`
+    Symbols at(const llvm::BasicBlock *bb) const {
+        State replayed = newState();
+        Symbols symbols;
+        for(const auto &[v, id] : state(bb, replayed)) {
+            symbols.emplace_hint(symbols.end(), v, table[id]);
+        }
+
+        return symbols;
+    }
+
+    // state flowing along the edge from `from` to `to`, refined by the branch ending `from`
+    Symbols at(const llvm::BasicBlock *from, const llvm::BasicBlock *to) const {
+        State replayed = newState();
+        Symbols symbols;
+        for(const auto &[v, id] : edge(newState(), from, state(from, replayed), to)) {
+            symbols.emplace_hint(symbols.end(), v, table[id]);
+        }
+
+        return symbols;
+    }
+
+    // states at the end of every block, as at() gives them. at() replays a block from its checkpoint
+    // on every call, which is quadratic over a chain; here each chain is replayed once,
+    // every block continuing from the state of its predecessor
+    std::map<const llvm::BasicBlock*, Symbols> atAll() const {
+        std::map<const llvm::BasicBlock*, State> replayed;
+        auto known = [&](const llvm::BasicBlock *bb) -> const State* {
+            if(auto iter = dataMap.find(bb); iter != dataMap.end()) return &iter->second;
+            if(auto iter = replayed.find(bb); iter != replayed.end()) return &iter->second;
+            return nullptr;
+        };
+
+        for(const auto &[bb, block] : program) {
+            std::vector<const llvm::BasicBlock*> chain;
+            for(auto cur = bb; !known(cur); cur = program.at(cur).preds.front()) {
+                chain.push_back(cur);
+            }
+
+            for(auto iter = chain.rbegin(); iter != chain.rend(); ++iter) {
+                auto from = program.at(*iter).preds.front();
+                auto symbols = transfer(*iter, edge(newState(), from, *known(from), *iter));
+                prune(*iter, symbols);
+                replayed.emplace(*iter, std::move(symbols));
+            }
+        }
+
+        std::map<const llvm::BasicBlock*, Symbols> all;
+        for(const auto &[bb, block] : program) {
+            auto &symbols = all[bb];
+            for(const auto &[v, id] : *known(bb)) {
+                symbols.emplace_hint(symbols.end(), v, table[id]);
+            }
+        }
+
+        return all;
+    }
+
+    // returns the stored state of `bb`, or replays it into `replayed`
+    // from the closest checkpoint up its single predecessor chain
+    const State &state(const llvm::BasicBlock *bb, State &replayed) const {
+        if(auto iter = dataMap.find(bb); iter != dataMap.end()) {
+            return iter->second;
+        }
+
+        std::vector<const llvm::BasicBlock*> chain{bb};
+        while(!dataMap.count(program.at(chain.back()).preds.front())) {
+            chain.push_back(program.at(chain.back()).preds.front());
+        }
+
+        auto from = program.at(chain.back()).preds.front();
+        replayed = dataMap.at(from);
+        for(auto iter = chain.rbegin(); iter != chain.rend(); ++iter) {
+            replayed = transfer(*iter, edge(newState(), from, replayed, *iter));
+            prune(*iter, replayed);
+            from = *iter;
+        }
+
+        return replayed;
+    }
+
+    // backward liveness over the decoded program: a value is live where a later read can see it,
+    // stores to slots and instruction results end the live ranges above them
+    void computeLiveness() {
+        std::map<const llvm::BasicBlock*, std::set<const llvm::Value*>> liveIn;
+
+        std::vector<const llvm::BasicBlock*> stack;
+        for(const auto &[bb, block] : program) {
+            stack.push_back(bb);
+        }
+
+        while(!stack.empty()) {
+            auto bb = stack.back();
+            stack.pop_back();
+
+            const auto &block = program.at(bb);
+            const auto &branch = block.branch;
+
+            auto &out = live[bb];
+            out.clear();
+            for(auto v : {branch.cond, branch.lOperand.value, branch.rOperand.value}) {
+                if(v) out.insert(v);
+            }
+            if(auto ret = llvm::dyn_cast<llvm::ReturnInst>(bb->getTerminator()); ret && ret->getReturnValue()) {
+                out.insert(ret->getReturnValue());
+            }
+            for(auto succ : block.succs) {
+                out.insert(liveIn[succ].begin(), liveIn[succ].end());
+            }
+
+            auto in = out;
+            for(auto iter = block.insts.rbegin(); iter != block.insts.rend(); ++iter) {
+                in.erase(iter->to);
+                if(iter->l.value) in.insert(iter->l.value);
+                if(iter->r.value) in.insert(iter->r.value);
+            }
+
+            if(in != liveIn[bb]) {
+                liveIn[bb] = std::move(in);
+                stack.insert(stack.end(), block.preds.begin(), block.preds.end());
+            }
+        }
+    }
+
+    void prune(const llvm::BasicBlock *bb, State &symbols) const {
+        if(!options.pruneDead) {
+            return;
+        }
+
+        const auto &keep = live.at(bb);
+        for(auto iter = symbols.begin(); iter != symbols.end();) {
+            iter = keep.count(iter->first) ? std::next(iter) : symbols.erase(iter);
+        }
+    }
+
+    void placeCheckpoints(const llvm::Function *f) {
+        for(const auto &[bb, block] : program) {
+            if(!options.checkpointOnly || bb == &f->getEntryBlock() ||
+                block.preds.size() != 1 || block.succs.empty()) {
+                dataMap.emplace(bb, newState());
+            }
+        }
+
+        // heads of reachable loops are join points already,
+        // what is left to cut are cycles of single predecessor blocks
+        std::set<const llvm::BasicBlock*> resolved;
+        for(const auto &[bb, block] : program) {
+            std::vector<const llvm::BasicBlock*> chain;
+            auto cur = bb;
+
+            while(!dataMap.count(cur) && !resolved.count(cur) &&
+                std::find(chain.begin(), chain.end(), cur) == chain.end()) {
+                chain.push_back(cur);
+                cur = program.at(cur).preds.front();
+            }
+
+            if(!dataMap.count(cur) && !resolved.count(cur)) {
+                dataMap.emplace(cur, newState());
+            }
+
+            resolved.insert(chain.begin(), chain.end());
+        }
+    }
+
+    State merge(const std::vector<const llvm::BasicBlock*>& vec, const llvm::BasicBlock *to,
+            bool refine = true) const {
+        return std::accumulate(vec.begin(), vec.end(), newState(), [this, to, refine](
+                const State& symbols, const llvm::BasicBlock* bb) {
+            State replayed = newState();
+            return edge(symbols, bb, state(bb, replayed), to, refine);
         });
     }
 
+    // joins `symbols` with what flows along the edge from `bb` to `to`, given the state `bbSymbols` of `bb`
+    State edge(const State& symbols, const llvm::BasicBlock *bb, const State& bbSymbols,
+            const llvm::BasicBlock *to, bool refine = true) const {
+        const auto &branch = program.at(bb).branch;
+        auto newSymbols = State::join(table, symbols, bbSymbols);
+
+        if(!branch.cond) {
+            return newSymbols;
+        }
+
+        auto condIter = bbSymbols.find(branch.cond);
+        if(condIter == bbSymbols.end()) {
+            return newSymbols;
+        }
+
+        // a decided condition only lets the state through the edge it takes
+        const auto &condVal = table[condIter->second];
+        if(condVal.isConstant()) {
+            if(branch.t != branch.f && to != (condVal.getLeft().getBoolValue() ? branch.t : branch.f)) {
+                newSymbols = symbols;
+            }
+        }
+        else if(refine && condVal.length() != 0 && branch.refined() && branch.t != branch.f) {
+            // the comparison only reads and refines its two operands
+            ArenaAllocator<char> alloc(&memory->expressions);
+            auto solverSymbols = std::allocate_shared<Symbols>(alloc, Symbols{
+                {branch.l, table[read(branch.lOperand, bbSymbols)]},
+                {branch.r, table[read(branch.rOperand, bbSymbols)]}});
+
+            auto condExpr = std::allocate_shared<BinOp<const llvm::Value *>>(alloc,
+                    cmpInstToBoolExpr<const llvm::Value*>(branch.predicate),
+                    std::allocate_shared<Atom<const llvm::Value *>>(alloc, branch.l),
+                    std::allocate_shared<Atom<const llvm::Value *>>(alloc, branch.r));
+
+            IntervalSolver<const llvm::Value *> solver{solverSymbols, condExpr};
+
+            // the comparison holds on the edge to the true successor and fails on the other.
+            // the same direction as solve(t != to) before decoding, where t was the false successor
+            // since a conditional br keeps it in operand 1
+            auto solvedSymbols = solver.solve(branch.t == to);
+            auto l = table.intern(solvedSymbols.at(branch.l)), r = table.intern(solvedSymbols.at(branch.r));
+
+            // constants live in the pool, they only join the state for solving
+            auto refined = bbSymbols;
+            if(branch.lOperand.value) refined[branch.l] = l;
+            if(branch.rOperand.value) refined[branch.r] = r;
+            if(branch.lSlot) refined[branch.lSlot] = l;
+            if(branch.rSlot) refined[branch.rSlot] = r;
+
+            newSymbols = State::join(table, symbols, refined);
+        }
+
+        return newSymbols;
+    }
+
     template <typename T>
     static typename BoolExpr<T>::Opcode cmpInstToBoolExpr(llvm::CmpInst::Predicate p) {
         switch (p) {
@@ -135,115 +755,72 @@ struct IntervalAnalysis {
         }
     }
 
-    static Symbols transfer(const llvm::BasicBlock *bb, Symbols& symbols) {
-        for(const auto &inst : bb->getInstList()) {
-            switch (inst.getOpcode()) {
-                case llvm::Instruction::Alloca: {
-                    auto ty = inst.getType()->getPointerElementType();
-                    if(ty->isIntegerTy()) {
-                        symbols[&inst] = Interval(
-                                APSInt::getMinValue(ty->getIntegerBitWidth(), false),
-                                APSInt::getMaxValue(ty->getIntegerBitWidth(), false));
-                    }
-                    break;
-                }
-                case llvm::Instruction::Store: {
-                    auto from = inst.getOperand(0), to = inst.getOperand(1);
-                    auto ty = to->getType()->getPointerElementType();
-
-                    if(!ty->isIntegerTy()) {
-                        break;
-                    }
+    State transfer(const llvm::BasicBlock *bb, State symbols) const {
+        for(const auto &inst : program.at(bb).insts) {
+            execute(inst, symbols);
+        }
 
-                    symbols.at(to) = fromSymbolOrConstant(from, symbols);
-                    break;
-                }
-                case llvm::Instruction::Load: {
-                    auto from = inst.getOperand(0), to = (llvm::Value*)&inst;
-                    auto ty = from->getType()->getPointerElementType();
+        return symbols;
+    }
 
-                    if(!ty->isIntegerTy()) {
-                        break;
-                    }
+    void execute(const Inst &inst, State& symbols) const {
+        if(inst.opcode == Inst::Copy) {
+            symbols[inst.to] = read(inst.l, symbols);
+            return;
+        }
 
-                    symbols[to] = symbols.at(from);
-                    break;
-                }
-                case llvm::Instruction::Add: {
-                    doBinOp(inst, symbols, [](const Interval& a, const Interval& b) {
-                        return a + b;
-                    });
-                    break;
-                }
-                case llvm::Instruction::Sub: {
-                    doBinOp(inst, symbols, [](const Interval& a, const Interval& b) {
-                        return a - b;
-                    });
-                    break;
-                }
-                case llvm::Instruction::Mul: {
-                    doBinOp(inst, symbols, [](const Interval& a, const Interval& b) {
-                        return a * b;
-                    });
-                    break;
-                }
-                case llvm::Instruction::SDiv: {
-                    doBinOp(inst, symbols, [](const Interval& a, const Interval& b) {
-                        return a / b;
-                    });
-                    break;
-                }
-                case llvm::Instruction::ICmp: {
-                    const auto &cmpInst = (const llvm::CmpInst &)inst;
-
-                    auto l = inst.getOperand(0), r = inst.getOperand(1);
-                    auto lVal = fromSymbolOrConstant(l, symbols), rVal = fromSymbolOrConstant(r, symbols);
-
-                    switch (cmpInst.getPredicate()) {
-                        case llvm::CmpInst::ICMP_EQ:
-                            symbols[&inst] = fromTernary(lVal == rVal);
-                            break;
-                        case llvm::CmpInst::ICMP_NE:
-                            symbols[&inst] = fromTernary(lVal != rVal);
-                            break;
-                        case llvm::CmpInst::ICMP_SLT:
-                            symbols[&inst] = fromTernary(lVal < rVal);
-                            break;
-                        case llvm::CmpInst::ICMP_SLE:
-                            symbols[&inst] = fromTernary(lVal <= rVal);
-                            break;
-                        case llvm::CmpInst::ICMP_SGT:
-                            symbols[&inst] = fromTernary(lVal > rVal);
-                            break;
-                        case llvm::CmpInst::ICMP_SGE:
-                            symbols[&inst] = fromTernary(lVal >= rVal);
-                            break;
-                        default:
-                            break;
-                    }
-
-                    break;
-                }
-                default:
-                    break;
-            }
+        const auto &l = table[read(inst.l, symbols)], &r = table[read(inst.r, symbols)];
+        Interval res;
+        switch (inst.opcode) {
+            case Inst::Add:
+                res = l + r;
+                break;
+            case Inst::Sub:
+                res = l - r;
+                break;
+            case Inst::Mul:
+                res = l * r;
+                break;
+            case Inst::SDiv:
+                res = l / r;
+                break;
+            case Inst::ICmp:
+                res = fromTernary(compare(inst.predicate, l, r));
+                break;
+            default:
+                break;
         }
 
-        return symbols;
+        symbols[inst.to] = table.intern(res);
     }
 
-    static void doBinOp(const llvm::Instruction &inst, Symbols& symbols,
-            const std::function<Interval(const Interval& a, const Interval& b)>& op) {
-        auto l = inst.getOperand(0), r = inst.getOperand(1);
-        auto ty = l->getType();
-
-        if(!ty->isIntegerTy()) {
-            return;
+    static Ternary compare(llvm::CmpInst::Predicate p, const Interval& lVal, const Interval& rVal) {
+        switch (p) {
+            case llvm::CmpInst::ICMP_EQ:
+                return lVal == rVal;
+            case llvm::CmpInst::ICMP_NE:
+                return lVal != rVal;
+            case llvm::CmpInst::ICMP_SLT:
+                return lVal < rVal;
+            case llvm::CmpInst::ICMP_SLE:
+                return lVal <= rVal;
+            case llvm::CmpInst::ICMP_SGT:
+                return lVal > rVal;
+            case llvm::CmpInst::ICMP_SGE:
+                return lVal >= rVal;
+            default:
+                return {};
         }
+    }
 
-        auto lVal = fromSymbolOrConstant(l, symbols), rVal = fromSymbolOrConstant(r, symbols);
+    IntervalTable::Id read(const Operand &operand, const State &symbols) const {
+        if(operand.value) {
+            if(auto iter = symbols.find(operand.value); iter != symbols.end()) {
+                return iter->second;
+            }
+        }
 
-        symbols[&inst] = op(lVal, rVal);
+        return constantPool[operand.constant];
     }
 
     static Interval fromTernary(Ternary t) {
@@ -261,13 +838,35 @@ struct IntervalAnalysis {
         return {};
     }
 
-    static Interval fromSymbolOrConstant(const llvm::Value *v, Symbols &symbols) {
-        if(auto c = llvm::dyn_cast<llvm::Constant>(v)) {
-            symbols[v] = Interval{
-                APSInt(c->getUniqueInteger(), false).extend(v->getType()->getIntegerBitWidth())};
+    static Interval topOf(unsigned width) {
+        return Interval::full(width);
+    }
+
+    unsigned top(unsigned width) {
+        auto [iter, inserted] = topIndex.emplace(width, constantPool.size());
+        if(inserted) {
+            constantPool.push_back(table.intern(topOf(width)));
         }
 
-        return symbols.at(v);
+        return iter->second;
+    }
+
+    unsigned constant(const APInt &c) {
+        auto id = table.intern(Interval(c));
+        auto [iter, inserted] = constantIndex.emplace(id, constantPool.size());
+        if(inserted) {
+            constantPool.push_back(id);
+        }
+
+        return iter->second;
+    }
+
+    Operand operand(const llvm::Value *v) {
+        return Decoded::operand(v, constants, *this);
+    }
+
+    bool isSlot(const llvm::Value *v) const {
+        return slots.count(v);
     }
 };
 
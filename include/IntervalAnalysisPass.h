@@ -0,0 +1,48 @@
+#ifndef CODEPUNK_INTERVALANALYSISPASS_H
+#define CODEPUNK_INTERVALANALYSISPASS_H
+
+#include <IntervalAnalysis.h>
+#include <IntervalPrinter.h>
+#include <llvm/IR/PassManager.h>
+
+// wraps IntervalAnalysis as a new pass manager function analysis,
+// results are invalidated by the analysis manager unless preserved
+struct IntervalAnalysisPass : llvm::AnalysisInfoMixin<IntervalAnalysisPass> {
+    using Result = IntervalAnalysis;
+
+    int maxIteration;
+    IntervalAnalysisOptions options;
+
+    explicit IntervalAnalysisPass(int maxIteration = -1, const IntervalAnalysisOptions &options = {})
+        : maxIteration(maxIteration), options(options) {}
+
+    Result run(llvm::Function &f, llvm::FunctionAnalysisManager &) {
+        IntervalAnalysis analysis(&f, options);
+        analysis.analyze(maxIteration);
+
+        return analysis;
+    }
+
+private:
+    friend llvm::AnalysisInfoMixin<IntervalAnalysisPass>;
+
+    inline static llvm::AnalysisKey Key;
+};
+
+struct IntervalAnalysisPrinterPass : llvm::PassInfoMixin<IntervalAnalysisPrinterPass> {
+    llvm::raw_ostream &o;
+
+    explicit IntervalAnalysisPrinterPass(llvm::raw_ostream &o) : o(o) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &f, llvm::FunctionAnalysisManager &fam) {
+        printIntervalAnalysis(o, &f, fam.getResult<IntervalAnalysisPass>(f));
+
+        return llvm::PreservedAnalyses::all();
+    }
+
+    static bool isRequired() {
+        return true;
+    }
+};
+
+#endif //CODEPUNK_INTERVALANALYSISPASS_H
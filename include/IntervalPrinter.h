@@ -0,0 +1,70 @@
+#ifndef CODEPUNK_INTERVALPRINTER_H
+#define CODEPUNK_INTERVALPRINTER_H
+
+#include <DomainAnalysis.h>
+#include <IntervalAnalysis.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <string>
+
+inline llvm::raw_ostream &operator<<(llvm::raw_ostream& o, const llvm::Value *v) {
+    if(v->hasName()) {
+        return o << v->getName() << " <" << (void *)v << ">";
+    }
+    if(auto c = llvm::dyn_cast<llvm::Constant>(v)) {
+        return o << c->getUniqueInteger() << " <" << (void *)v << ">";
+    }
+
+    return o << (void *)v;
+}
+
+// the instructions of `f` block by block, each followed by the values of `stateAt(bb)`, the state at its end
+template <typename StateAt>
+void printStates(llvm::raw_ostream& o, const llvm::Function* f, const StateAt& stateAt) {
+    for(const auto& v : f->args()) {
+        o << "  | " << &v;
+    }
+    o << "\n";
+    for(const auto& bb : f->getBasicBlockList()) {
+        o << "  [" << &bb << "]\n";
+
+        for(const auto& inst : bb.getInstList()) {
+            o << "\t" << inst.getOpcodeName() << " (";
+            bool isF = true;
+            for(const auto& v : inst.operands()) {
+                if(isF) isF = false;
+                else o << ", ";
+
+                o << v;
+            }
+            o << ")->" << &inst << "\n";
+        }
+
+        o << "  \t" << std::string(50, '-') << "\n";
+
+        const auto res = stateAt(&bb);
+        for(const auto &j : res) {
+            o << "\t" << j.first << " : " << j.second << "\n";
+        }
+    }
+}
+
+inline void printIntervalAnalysis(llvm::raw_ostream& o, const llvm::Function* f, const IntervalAnalysis& analysis) {
+    o << f->getName() << ":";
+    if(analysis.exhausted != IntervalAnalysis::None) {
+        o << " (degraded: " << IntervalAnalysis::budgetName(analysis.exhausted) << " budget exhausted)";
+    }
+    o << "\n";
+
+    auto states = analysis.atAll();
+    printStates(o, f, [&](const llvm::BasicBlock *bb) -> const IntervalAnalysis::Symbols& { return states.at(bb); });
+}
+
+template <typename Domain>
+void printDomainAnalysis(llvm::raw_ostream& o, const llvm::Function* f, const DomainAnalysis<Domain>& analysis) {
+    o << f->getName() << ": (domain: " << Domain::Name << ")\n";
+    printStates(o, f, [&](const llvm::BasicBlock *bb) { return analysis.at(bb); });
+}
+
+#endif //CODEPUNK_INTERVALPRINTER_H
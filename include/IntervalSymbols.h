@@ -6,14 +6,20 @@
 #define CODEPUNK_INTERVALSYMBOLS_H
 
 #include <Interval.h>
+#include <algorithm>
 #include <map>
-#include <functional>
 
 template <typename Key>
 struct IntervalSymbols : std::map<Key, Interval> {
     using std::map<Key, Interval>::map;
 
-    static IntervalSymbols symbolOp(const std::function<Interval(const Interval& a, const Interval& b)>& op,
+    [[nodiscard]] bool equals(const IntervalSymbols& v) const {
+        return this->size() == v.size() && std::equal(this->begin(), this->end(), v.begin(),
+            [](const auto& a, const auto& b) { return a.first == b.first && a.second.equals(b.second); });
+    }
+
+    template <typename Op>
+    static IntervalSymbols symbolOp(const Op& op,
             const IntervalSymbols& a, const IntervalSymbols& b,
             bool addUniqueItem = true) {
         IntervalSymbols symbols;
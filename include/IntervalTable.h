@@ -0,0 +1,120 @@
+#ifndef CODEPUNK_INTERVALTABLE_H
+#define CODEPUNK_INTERVALTABLE_H
+
+#include <Arena.h>
+#include <Interval.h>
+#include <llvm/ADT/Hashing.h>
+
+#include <cstdint>
+
+// interns intervals so that states can hold them as 32-bit ids:
+// equal intervals always get the same id, so comparing states only compares ids,
+// and the joins and meets of id pairs are memoized since the same few pairs come up over and over
+struct IntervalTable {
+    using Id = uint32_t;
+
+    ArenaVector<Interval> intervals;
+    ArenaHashMultimap<size_t, Id> index;
+    ArenaHashMap<uint64_t, Id> joins, meets;
+
+    // counts the heap words of intervals wider than 64 bits, which APInt does not take from `resource`
+    MemoryCounter *wide;
+
+    explicit IntervalTable(std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+            MemoryCounter *wide = nullptr)
+        : intervals(resource), index(resource), joins(resource), meets(resource), wide(wide) {}
+
+    const Interval &operator[](Id id) const {
+        return intervals[id];
+    }
+
+    [[nodiscard]] size_t size() const {
+        return intervals.size();
+    }
+
+    Id intern(const Interval &v) {
+        size_t hash = llvm::hash_combine(v.getLeft().getBitWidth(), llvm::hash_value(v.getLeft()),
+                llvm::hash_value(v.getRight()));
+
+        auto [first, last] = index.equal_range(hash);
+        for(auto iter = first; iter != last; ++iter) {
+            const auto &u = intervals[iter->second];
+            if(u.getLeft().getBitWidth() == v.getLeft().getBitWidth() && u.equals(v)) {
+                return iter->second;
+            }
+        }
+
+        Id id = intervals.size();
+        intervals.push_back(v);
+        if(wide && v.getLeft().getNumWords() > 1) {
+            wide->allocate(v.getLeft().getNumWords() * sizeof(uint64_t));
+            wide->allocate(v.getRight().getNumWords() * sizeof(uint64_t));
+        }
+        index.emplace(hash, id);
+        return id;
+    }
+
+    Id join(Id a, Id b) {
+        if(a == b) return a;
+        return memoize(joins, a, b, [](const Interval &l, const Interval &r) { return l | r; });
+    }
+
+    Id meet(Id a, Id b) {
+        if(a == b) return a;
+        return memoize(meets, a, b, [](const Interval &l, const Interval &r) { return l & r; });
+    }
+
+    template <typename Op>
+    Id memoize(ArenaHashMap<uint64_t, Id> &memo, Id a, Id b, const Op &op) {
+        // both ops are commutative
+        if(a > b) std::swap(a, b);
+
+        auto key = (uint64_t(a) << 32u) | b;
+        if(auto iter = memo.find(key); iter != memo.end()) {
+            return iter->second;
+        }
+
+        auto res = intern(op(intervals[a], intervals[b]));
+        memo.emplace(key, res);
+        return res;
+    }
+};
+
+// a block state over interned intervals, joins and meets go through the table of the analysis.
+// results are allocated from the same arena as their first operand
+template <typename Key>
+struct IdSymbols : ArenaMap<Key, IntervalTable::Id> {
+    using Base = ArenaMap<Key, IntervalTable::Id>;
+    using Base::Base;
+
+    [[nodiscard]] bool equals(const IdSymbols& v) const {
+        return *this == v;
+    }
+
+    static IdSymbols join(IntervalTable &table, const IdSymbols& a, const IdSymbols& b) {
+        IdSymbols symbols = a;
+
+        for(const auto &[k, id] : b) {
+            auto [iter, inserted] = symbols.emplace(k, id);
+            if(!inserted) {
+                iter->second = table.join(iter->second, id);
+            }
+        }
+
+        return symbols;
+    }
+
+    static IdSymbols meet(IntervalTable &table, const IdSymbols& a, const IdSymbols& b) {
+        IdSymbols symbols(a.get_allocator());
+
+        for(const auto &[k, id] : a) {
+            if(auto iter = b.find(k); iter != b.end()) {
+                symbols.emplace(k, table.meet(id, iter->second));
+            }
+        }
+
+        return symbols;
+    }
+};
+
+#endif //CODEPUNK_INTERVALTABLE_H
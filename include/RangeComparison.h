@@ -0,0 +1,58 @@
+#ifndef CODEPUNK_RANGECOMPARISON_H
+#define CODEPUNK_RANGECOMPARISON_H
+
+#include <Interval.h>
+#include <llvm/IR/ConstantRange.h>
+
+#include <cstddef>
+
+// the values an interval holds as a ConstantRange, empty for an invalid interval
+inline llvm::ConstantRange toConstantRange(const Interval &v) {
+    unsigned width = v.getLeft().getBitWidth();
+    if(!v.isValid()) {
+        return llvm::ConstantRange::getEmpty(width);
+    }
+
+    APInt lo = v.getLeft(), hi = v.getRight() + 1;
+    if(lo == hi) {
+        return llvm::ConstantRange::getFull(width);
+    }
+
+    return llvm::ConstantRange(lo, hi);
+}
+
+// how the ranges two analyses give for the same values compare, counted per value
+struct RangeComparison {
+    // `ours` is strictly inside `theirs`, or the other way around
+    size_t tighter = 0, looser = 0;
+    size_t equal = 0;
+    // overlapping but neither contains the other
+    size_t incomparable = 0;
+    // no value in common, one of the two analyses is wrong unless the value is never computed
+    size_t disjoint = 0;
+
+    void add(const llvm::ConstantRange &ours, const llvm::ConstantRange &theirs) {
+        if(ours == theirs) {
+            equal++;
+        } else if(theirs.contains(ours)) {
+            tighter++;
+        } else if(ours.contains(theirs)) {
+            looser++;
+        } else if(ours.intersectWith(theirs).isEmptySet()) {
+            disjoint++;
+        } else {
+            incomparable++;
+        }
+    }
+
+    RangeComparison &operator+=(const RangeComparison &other) {
+        tighter += other.tighter;
+        looser += other.looser;
+        equal += other.equal;
+        incomparable += other.incomparable;
+        disjoint += other.disjoint;
+        return *this;
+    }
+};
+
+#endif //CODEPUNK_RANGECOMPARISON_H
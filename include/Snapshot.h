@@ -0,0 +1,444 @@
+#ifndef CODEPUNK_SNAPSHOT_H
+#define CODEPUNK_SNAPSHOT_H
+
+#include <Driver.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/xxhash.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// a snapshot is an append-only log of analysis progress, so that a run killed halfway can pick up where it stopped.
+// it starts with a header record holding the options the states were computed with, followed by one record
+// per checkpoint of a function: its worklist, counters and completion, and only the block states changed since
+// its previous checkpoint. every record is `tag:u8 length:u32 payload`, little-endian,
+// so a record cut short by a kill is recognized and dropped when the log is read back,
+// and cut off before the log is continued.
+// blocks and values are referred to by their position in the function, see FunctionNumbering
+
+// blocks and values of a function by position: the arguments, then the instructions in order
+struct FunctionNumbering {
+    std::vector<const llvm::BasicBlock*> blocks;
+    std::vector<const llvm::Value*> values;
+    std::map<const llvm::BasicBlock*, uint32_t> blockIndex;
+    std::map<const llvm::Value*, uint32_t> valueIndex;
+
+    explicit FunctionNumbering(const llvm::Function &f) {
+        for(const auto &arg : f.args()) {
+            add(&arg);
+        }
+        for(const auto &bb : f) {
+            blockIndex.emplace(&bb, blocks.size());
+            blocks.push_back(&bb);
+            for(const auto &inst : bb) {
+                add(&inst);
+            }
+        }
+    }
+
+    void add(const llvm::Value *v) {
+        valueIndex.emplace(v, values.size());
+        values.push_back(v);
+    }
+};
+
+// what the log holds for one function, with later checkpoints applied over earlier ones
+struct SnapshotFunction {
+    std::string name;
+    uint32_t blocks = 0, values = 0;
+
+    uint64_t iterations = 0;
+    int32_t tier = 0;
+    uint8_t exhausted = 0;
+    bool done = false;
+
+    std::vector<uint32_t> workList;
+    std::map<uint32_t, std::vector<std::pair<uint32_t, Interval>>> states;
+
+    [[nodiscard]] bool matches(const llvm::Function &f, const FunctionNumbering &numbering) const {
+        return name == f.getName() && blocks == numbering.blocks.size() && values == numbering.values.size();
+    }
+};
+
+struct Snapshot {
+    enum Tag : uint8_t { Header = 'H', Checkpoint = 'C' };
+    static constexpr uint32_t Magic = 0x4e535043; // "CPSN"
+    static constexpr uint32_t Version = 2;
+
+    std::string header;
+    // by position among the defined functions of the module
+    std::map<uint32_t, SnapshotFunction> functions;
+
+    // hash of the bitcode of `mod`: a module edited between runs can keep its function names
+    // and block and value counts, so those alone do not tie a snapshot to it
+    static uint64_t hashModule(const llvm::Module &mod) {
+        std::string bitcode;
+        llvm::raw_string_ostream o(bitcode);
+        llvm::WriteBitcodeToFile(mod, o);
+
+        return llvm::xxHash64(o.str());
+    }
+
+    // states computed for another module or under other options do not carry over
+    static std::string encodeHeader(const IntervalAnalysisOptions &options, uint64_t module) {
+        std::string payload;
+        llvm::raw_string_ostream o(payload);
+        llvm::support::endian::Writer w(o, llvm::support::little);
+
+        w.write<uint32_t>(Magic);
+        w.write<uint32_t>(Version);
+        w.write<uint64_t>(module);
+        w.write<uint8_t>(options.checkpointOnly);
+        w.write<uint8_t>(options.tiered);
+        w.write<uint8_t>(options.accelerateLoops);
+        w.write<uint8_t>(options.pruneDead);
+        w.write<uint32_t>(options.iterationBudget);
+        w.write<uint32_t>(options.timeBudgetMs);
+        w.write<uint64_t>(options.memoryBudget);
+
+        return o.str();
+    }
+
+    // reads a log back, up to its first incomplete record. returns the length of the complete records,
+    // or nothing if it is not a snapshot at all
+    std::optional<size_t> read(llvm::StringRef data) {
+        header.clear();
+        functions.clear();
+
+        Reader r{data};
+        size_t valid = 0;
+        while(r.left() >= 5) {
+            auto tag = r.read<uint8_t>();
+            auto length = r.read<uint32_t>();
+            if(r.left() < length) {
+                break;
+            }
+
+            Reader payload{data.substr(r.pos, length)};
+            r.pos += length;
+
+            if(tag == Header && header.empty()) {
+                header = payload.data.str();
+            } else if(tag == Checkpoint && !header.empty()) {
+                if(!readCheckpoint(payload)) {
+                    return std::nullopt;
+                }
+            } else {
+                return std::nullopt;
+            }
+            valid = r.pos;
+        }
+
+        if(header.empty()) {
+            return std::nullopt;
+        }
+
+        return valid;
+    }
+
+private:
+    struct Reader {
+        llvm::StringRef data;
+        size_t pos = 0;
+        bool failed = false;
+
+        [[nodiscard]] size_t left() const {
+            return data.size() - pos;
+        }
+
+        template <typename T>
+        T read() {
+            if(left() < sizeof(T)) {
+                failed = true;
+                pos = data.size();
+                return T();
+            }
+
+            auto v = llvm::support::endian::read<T, llvm::support::little, llvm::support::unaligned>(data.data() + pos);
+            pos += sizeof(T);
+            return v;
+        }
+
+        APInt readAPInt(unsigned width) {
+            std::vector<uint64_t> words((width + 63) / 64);
+            for(auto &word : words) {
+                word = read<uint64_t>();
+            }
+
+            return APInt(width, words);
+        }
+    };
+
+    bool readCheckpoint(Reader &r) {
+        auto index = r.read<uint32_t>();
+        auto length = r.read<uint32_t>();
+        if(r.left() < length) {
+            return false;
+        }
+
+        std::string name(r.data.substr(r.pos, length));
+        r.pos += length;
+
+        bool seen = functions.count(index);
+        auto &function = functions[index];
+        auto blocks = r.read<uint32_t>();
+        auto values = r.read<uint32_t>();
+        if(seen && (function.name != name || function.blocks != blocks || function.values != values)) {
+            return false;
+        }
+        function.name = name;
+        function.blocks = blocks;
+        function.values = values;
+
+        function.iterations = r.read<uint64_t>();
+        function.tier = r.read<int32_t>();
+        function.exhausted = r.read<uint8_t>();
+        function.done = r.read<uint8_t>();
+
+        function.workList.resize(r.read<uint32_t>());
+        for(auto &bb : function.workList) {
+            bb = r.read<uint32_t>();
+        }
+
+        for(auto states = r.read<uint32_t>(); states > 0 && !r.failed; states--) {
+            auto &state = function.states[r.read<uint32_t>()];
+            state.clear();
+
+            for(auto entries = r.read<uint32_t>(); entries > 0 && !r.failed; entries--) {
+                auto value = r.read<uint32_t>();
+                auto width = r.read<uint32_t>();
+                bool isUnsigned = r.read<uint8_t>();
+                if(width == 0 || width > llvm::IntegerType::MAX_INT_BITS) {
+                    return false;
+                }
+
+                auto lo = r.readAPInt(width), hi = r.readAPInt(width);
+                state.emplace_back(value, Interval(lo, hi, isUnsigned));
+            }
+        }
+
+        return !r.failed && r.left() == 0;
+    }
+};
+
+// appends checkpoints to a snapshot log
+struct SnapshotWriter {
+    std::unique_ptr<llvm::raw_fd_ostream> os;
+
+    // continues the log at `path` after its first `append` bytes, the complete records Snapshot::read found,
+    // otherwise starts a new one for the module hashed to `module` and `options`. a record torn by a kill is cut off first,
+    // or its length would swallow the records appended after it
+    SnapshotWriter(const std::string &path, const IntervalAnalysisOptions &options, uint64_t module,
+            std::optional<size_t> append, std::error_code &ec) {
+        if(!append) {
+            os = std::make_unique<llvm::raw_fd_ostream>(path, ec, llvm::sys::fs::OF_None);
+            if(!ec) {
+                record(Snapshot::Header, Snapshot::encodeHeader(options, module));
+            }
+            return;
+        }
+
+        int fd;
+        ec = llvm::sys::fs::openFileForWrite(path, fd, llvm::sys::fs::CD_OpenExisting, llvm::sys::fs::OF_Append);
+        if(ec) {
+            return;
+        }
+
+        os = std::make_unique<llvm::raw_fd_ostream>(fd, true);
+        ec = llvm::sys::fs::resize_file(fd, *append);
+    }
+
+    // writes the progress of function `index` with the states changed since its last checkpoint,
+    // returns the number of states written
+    size_t checkpoint(uint32_t index, const FunctionNumbering &numbering, IntervalAnalysis &analysis, bool done) {
+        std::string payload;
+        llvm::raw_string_ostream o(payload);
+        llvm::support::endian::Writer w(o, llvm::support::little);
+
+        auto name = analysis.function->getName();
+        w.write<uint32_t>(index);
+        w.write<uint32_t>(name.size());
+        o << name;
+        w.write<uint32_t>(numbering.blocks.size());
+        w.write<uint32_t>(numbering.values.size());
+
+        w.write<uint64_t>(analysis.iterations);
+        w.write<int32_t>(analysis.tier);
+        w.write<uint8_t>(analysis.exhausted);
+        w.write<uint8_t>(done);
+
+        auto workList = analysis.workList;
+        w.write<uint32_t>(workList.size());
+        for(; !workList.empty(); workList.pop()) {
+            w.write<uint32_t>(numbering.blockIndex.at(workList.front()));
+        }
+
+        // blocks deleted by an edit may still be marked, and replayed blocks have no state to write
+        std::vector<std::pair<uint32_t, const IntervalAnalysis::State*>> states;
+        for(auto bb : analysis.dirty) {
+            auto block = numbering.blockIndex.find(bb);
+            auto state = analysis.dataMap.find(bb);
+            if(block != numbering.blockIndex.end() && state != analysis.dataMap.end()) {
+                states.emplace_back(block->second, &state->second);
+            }
+        }
+        analysis.dirty.clear();
+
+        w.write<uint32_t>(states.size());
+        for(auto [block, state] : states) {
+            w.write<uint32_t>(block);
+            w.write<uint32_t>(state->size());
+
+            for(const auto &[v, id] : *state) {
+                const auto &interval = analysis.table[id];
+                auto width = interval.getLeft().getBitWidth();
+
+                w.write<uint32_t>(numbering.valueIndex.at(v));
+                w.write<uint32_t>(width);
+                w.write<uint8_t>(interval.getLeft().isUnsigned());
+                for(const auto &bound : {interval.getLeft(), interval.getRight()}) {
+                    for(unsigned i = 0; i < bound.getNumWords(); i++) {
+                        w.write<uint64_t>(bound.getRawData()[i]);
+                    }
+                }
+            }
+        }
+
+        record(Snapshot::Checkpoint, o.str());
+        return states.size();
+    }
+
+    void record(Snapshot::Tag tag, const std::string &payload) {
+        llvm::support::endian::Writer w(*os, llvm::support::little);
+        w.write<uint8_t>(tag);
+        w.write<uint32_t>(payload.size());
+        *os << payload;
+
+        // a checkpoint only counts once it is out of the process
+        os->flush();
+    }
+};
+
+// puts the progress a snapshot holds for the function of `analysis` back into it
+inline void restoreSnapshot(IntervalAnalysis &analysis, const SnapshotFunction &function,
+        const FunctionNumbering &numbering) {
+    for(const auto &[block, entries] : function.states) {
+        auto iter = analysis.dataMap.find(numbering.blocks.at(block));
+        if(iter == analysis.dataMap.end()) {
+            continue;
+        }
+
+        analysis.stateEntries -= iter->second.size();
+        iter->second.clear();
+        for(const auto &[value, interval] : entries) {
+            iter->second.emplace(numbering.values.at(value), analysis.table.intern(interval));
+        }
+        analysis.stateEntries += iter->second.size();
+    }
+
+    analysis.workList = {};
+    for(auto block : function.workList) {
+        analysis.workList.push(numbering.blocks.at(block));
+    }
+
+    analysis.iterations = function.iterations;
+    analysis.tier = function.tier;
+    analysis.exhausted = IntervalAnalysis::Budget(function.exhausted);
+    // the time budget counts this run only
+    analysis.start = std::chrono::steady_clock::now();
+
+    // the log already holds everything restored
+    analysis.dirty.clear();
+}
+
+// whether every function a snapshot holds is still in `mod`, numbered the same way
+inline bool snapshotMatches(const Snapshot &snapshot, const std::vector<const llvm::Function*> &functions,
+        const std::vector<FunctionNumbering> &numberings) {
+    for(const auto &[index, function] : snapshot.functions) {
+        if(index >= functions.size() || !function.matches(*functions[index], numberings[index])) {
+            return false;
+        }
+        for(auto block : function.workList) {
+            if(block >= function.blocks) return false;
+        }
+        for(const auto &[block, entries] : function.states) {
+            if(block >= function.blocks) return false;
+            for(const auto &entry : entries) {
+                if(entry.first >= function.values) return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// analyzes the functions of `mod` one after the other like analyzeModule, checkpointing to the snapshot at `path`
+// every `interval` iterations and when a function is done. an existing snapshot of the same module and options
+// is resumed, functions it has done are not analyzed again. returns false if the snapshot cannot be written
+inline bool analyzeModuleResumable(const llvm::Module &mod, const DriverOptions &options, const std::string &path,
+        unsigned interval, llvm::raw_ostream &o, llvm::raw_ostream &err) {
+    std::vector<const llvm::Function*> functions;
+    std::vector<FunctionNumbering> numberings;
+    for(const auto &f : mod.getFunctionList()) {
+        if(!f.isDeclaration()) {
+            functions.push_back(&f);
+            numberings.emplace_back(f);
+        }
+    }
+
+    auto module = Snapshot::hashModule(mod);
+
+    Snapshot snapshot;
+    std::optional<size_t> resume;
+    if(auto buffer = llvm::MemoryBuffer::getFile(path); buffer && buffer.get()->getBufferSize() > 0) {
+        resume = snapshot.read(buffer.get()->getBuffer());
+        if(!resume || snapshot.header != Snapshot::encodeHeader(options.analysis, module) ||
+            !snapshotMatches(snapshot, functions, numberings)) {
+            resume.reset();
+            err << path << ": snapshot is of another module or options, starting over\n";
+            snapshot.functions.clear();
+        }
+    }
+
+    std::error_code ec;
+    SnapshotWriter writer(path, options.analysis, module, resume, ec);
+    if(ec) {
+        err << path << ": " << ec.message() << "\n";
+        return false;
+    }
+
+    for(uint32_t index = 0; index < functions.size(); index++) {
+        IntervalAnalysis analysis(functions[index], options.analysis);
+
+        bool done = false;
+        if(auto iter = snapshot.functions.find(index); iter != snapshot.functions.end()) {
+            restoreSnapshot(analysis, iter->second, numberings[index]);
+            done = iter->second.done;
+        }
+
+        while(!done) {
+            // the iteration limit is on the whole analysis, resumed iterations included
+            int left = options.maxIteration < 0 ? -1 : std::max(0, options.maxIteration - int(analysis.iterations));
+            int chunk = interval && (left < 0 || unsigned(left) > interval) ? int(interval) : left;
+
+            analysis.analyze(chunk);
+
+            done = analysis.workList.empty() || chunk == left;
+            writer.checkpoint(index, numberings[index], analysis, done);
+        }
+
+        printIntervalAnalysis(o, functions[index], analysis);
+        warnMemory(*functions[index], analysis, options.memoryWarning, err);
+    }
+
+    return true;
+}
+
+#endif //CODEPUNK_SNAPSHOT_H
@@ -0,0 +1,541 @@
+#ifndef CODEPUNK_TRANSFORMS_H
+#define CODEPUNK_TRANSFORMS_H
+
+#include <IntervalAnalysisPass.h>
+#include <TripCounts.h>
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Operator.h>
+#include <llvm/Transforms/Utils/Local.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// rewrites of a function driven by its analysis results.
+// they only trust an analysis that reached its fixpoint, a run cut short by an iteration limit proves nothing
+struct TransformOptions {
+    bool annotateRanges = false;
+    bool annotateTripCounts = false;
+    bool inferNoWrap = false;
+    bool insertAssumes = false;
+    bool foldBranches = false;
+    bool narrowWidths = false;
+
+    [[nodiscard]] bool any() const {
+        return annotateRanges || annotateTripCounts || inferNoWrap || insertAssumes || foldBranches || narrowWidths;
+    }
+};
+
+// the half-open range [l, r + 1) of a proper, non-full interval, which is what !range and ConstantRange describe
+inline std::optional<std::pair<APInt, APInt>> halfOpenRange(const Interval &v) {
+    if(!v.isValid()) {
+        return std::nullopt;
+    }
+
+    APInt lo = v.getLeft(), hi = v.getRight() + 1;
+    if(lo == hi) {
+        return std::nullopt;
+    }
+
+    return std::make_pair(lo, hi);
+}
+
+// attaches !range metadata to integer loads from the intervals they have at the end of their block.
+// loads are the only values read from memory the analysis knows anything about,
+// calls are not modeled and always have the full range of their type
+inline unsigned annotateRanges(llvm::Function &f, const IntervalAnalysis &analysis) {
+    if(!analysis.workList.empty()) {
+        return 0;
+    }
+
+    auto states = analysis.atAll();
+
+    std::vector<std::pair<llvm::LoadInst*, std::pair<APInt, APInt>>> ranged;
+    for(auto &bb : f) {
+        const auto &symbols = states.at(&bb);
+
+        for(auto &inst : bb) {
+            auto load = llvm::dyn_cast<llvm::LoadInst>(&inst);
+            if(!load || !load->getType()->isIntegerTy() || load->getMetadata(llvm::LLVMContext::MD_range)) {
+                continue;
+            }
+
+            if(auto iter = symbols.find(load); iter != symbols.end()) {
+                if(auto range = halfOpenRange(iter->second)) {
+                    ranged.emplace_back(load, *range);
+                }
+            }
+        }
+    }
+
+    for(auto &[load, range] : ranged) {
+        llvm::MDBuilder md(load->getContext());
+        load->setMetadata(llvm::LLVMContext::MD_range, md.createRange(range.first, range.second));
+    }
+
+    return ranged.size();
+}
+
+// property of the llvm.loop metadata holding proven trip counts: !{!"codepunk.trip.count", i64 min, i64 max}
+static constexpr const char *TripCountProperty = "codepunk.trip.count";
+
+// records the trip counts of bounded induction loops in the llvm.loop metadata of their latches,
+// keeping the other loop properties. passes that do not know the property keep it and ignore it.
+// returns the number of loops annotated
+inline unsigned annotateTripCounts(llvm::Function &f, const IntervalAnalysis &analysis) {
+    auto &ctx = f.getContext();
+    auto i64 = llvm::Type::getInt64Ty(ctx);
+
+    unsigned changes = 0;
+    for(const auto &count : tripCounts(f, analysis)) {
+        if(!count.max) {
+            continue;
+        }
+
+        std::vector<llvm::Instruction*> terms;
+        for(auto &bb : f) {
+            if(std::find(count.loop.latches.begin(), count.loop.latches.end(), &bb) != count.loop.latches.end()) {
+                terms.push_back(bb.getTerminator());
+            }
+        }
+
+        // the first operand of a loop id refers to the id itself
+        std::vector<llvm::Metadata*> properties{nullptr};
+        if(auto id = terms.front()->getMetadata(llvm::LLVMContext::MD_loop)) {
+            for(unsigned i = 1; i < id->getNumOperands(); i++) {
+                auto property = llvm::dyn_cast<llvm::MDNode>(id->getOperand(i));
+                auto name = property && property->getNumOperands() ?
+                        llvm::dyn_cast<llvm::MDString>(property->getOperand(0)) : nullptr;
+
+                if(!name || name->getString() != TripCountProperty) {
+                    properties.push_back(id->getOperand(i));
+                }
+            }
+        }
+
+        properties.push_back(llvm::MDNode::get(ctx, {
+                llvm::MDString::get(ctx, TripCountProperty),
+                llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(i64, count.min)),
+                llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(i64, *count.max))}));
+
+        auto id = llvm::MDNode::getDistinct(ctx, properties);
+        id->replaceOperandWith(0, id);
+
+        for(auto term : terms) {
+            term->setMetadata(llvm::LLVMContext::MD_loop, id);
+        }
+        changes++;
+    }
+
+    return changes;
+}
+
+// interval of `v` in `symbols`, constants stand for themselves and missing values have the full range of their type
+inline Interval intervalOf(const IntervalAnalysis::Symbols &symbols, const llvm::Value *v) {
+    if(auto c = llvm::dyn_cast<llvm::ConstantInt>(v)) {
+        return Interval(c->getValue());
+    }
+    if(auto iter = symbols.find(v); iter != symbols.end() && iter->second.isValid()) {
+        return iter->second;
+    }
+
+    return Interval::full(v->getType()->getIntegerBitWidth());
+}
+
+// unsigned bounds of a signed interval, if it does not straddle zero and so is contiguous as unsigned values too
+inline std::optional<std::pair<APInt, APInt>> unsignedBounds(const Interval &v) {
+    if(v.getLeft().isNegative() != v.getRight().isNegative()) {
+        return std::nullopt;
+    }
+
+    return std::make_pair(APInt(v.getLeft()), APInt(v.getRight()));
+}
+
+// whether `op` on any values of `l` and `r` stays in range as signed and as unsigned integers,
+// only the overflow flags of the bound arithmetic are of interest
+inline std::pair<bool, bool> provenNoWrap(unsigned op, const Interval &l, const Interval &r) {
+    bool sov[4] = {}, uov = true;
+    auto ul = unsignedBounds(l), ur = unsignedBounds(r);
+
+    switch (op) {
+        case llvm::Instruction::Add:
+            (void)l.getLeft().sadd_ov(r.getLeft(), sov[0]);
+            (void)l.getRight().sadd_ov(r.getRight(), sov[1]);
+            if(ul && ur) (void)ul->second.uadd_ov(ur->second, uov);
+            break;
+        case llvm::Instruction::Sub:
+            (void)l.getLeft().ssub_ov(r.getRight(), sov[0]);
+            (void)l.getRight().ssub_ov(r.getLeft(), sov[1]);
+            if(ul && ur) (void)ul->first.usub_ov(ur->second, uov);
+            break;
+        case llvm::Instruction::Mul:
+            (void)l.getLeft().smul_ov(r.getLeft(), sov[0]);
+            (void)l.getLeft().smul_ov(r.getRight(), sov[1]);
+            (void)l.getRight().smul_ov(r.getLeft(), sov[2]);
+            (void)l.getRight().smul_ov(r.getRight(), sov[3]);
+            if(ul && ur) (void)ul->second.umul_ov(ur->second, uov);
+            break;
+        default:
+            return {false, false};
+    }
+
+    return {!(sov[0] || sov[1] || sov[2] || sov[3]), !uov};
+}
+
+// sets nsw and nuw on adds, subs and muls whose operand intervals prove they cannot overflow.
+// returns the number of instructions that gained a flag
+inline unsigned inferNoWrap(llvm::Function &f, const IntervalAnalysis &analysis) {
+    if(!analysis.workList.empty()) {
+        return 0;
+    }
+
+    auto states = analysis.atAll();
+
+    unsigned changes = 0;
+    for(auto &bb : f) {
+        // operands are SSA values, their interval at the end of the block holds wherever they are read in it
+        const auto &symbols = states.at(&bb);
+
+        for(auto &inst : bb) {
+            auto op = llvm::dyn_cast<llvm::OverflowingBinaryOperator>(&inst);
+            if(!op || !inst.getType()->isIntegerTy() || (op->hasNoSignedWrap() && op->hasNoUnsignedWrap())) {
+                continue;
+            }
+
+            auto [nsw, nuw] = provenNoWrap(inst.getOpcode(),
+                    intervalOf(symbols, inst.getOperand(0)), intervalOf(symbols, inst.getOperand(1)));
+
+            bool changed = false;
+            if(nsw && !op->hasNoSignedWrap()) {
+                inst.setHasNoSignedWrap();
+                changed = true;
+            }
+            if(nuw && !op->hasNoUnsignedWrap()) {
+                inst.setHasNoUnsignedWrap();
+                changed = true;
+            }
+
+            changes += changed;
+        }
+    }
+
+    return changes;
+}
+
+// makes the refinement of branch conditions explicit: where a block is only entered through one edge
+// of a conditional branch, the operands of its comparison get an llvm.assume of every bound
+// the edge tightened. returns the number of assumes inserted
+inline unsigned insertAssumes(llvm::Function &f, const IntervalAnalysis &analysis) {
+    if(!analysis.workList.empty()) {
+        return 0;
+    }
+
+    auto states = analysis.atAll();
+
+    struct Fact {
+        llvm::BasicBlock *bb;
+        llvm::Value *v;
+        llvm::CmpInst::Predicate predicate;
+        APInt bound;
+    };
+
+    std::vector<Fact> facts;
+    for(auto &bb : f) {
+        auto pred = bb.getSinglePredecessor();
+        if(!pred || pred == &bb) {
+            continue;
+        }
+
+        auto br = llvm::dyn_cast<llvm::BranchInst>(pred->getTerminator());
+        auto cmp = br && br->isConditional() ? llvm::dyn_cast<llvm::ICmpInst>(br->getCondition()) : nullptr;
+        if(!cmp || br->getSuccessor(0) == br->getSuccessor(1)) {
+            continue;
+        }
+
+        const auto &before = states.at(pred);
+        auto after = analysis.at(pred, &bb);
+        for(auto v : {cmp->getOperand(0), cmp->getOperand(1)}) {
+            if(llvm::isa<llvm::Constant>(v) || !v->getType()->isIntegerTy()) {
+                continue;
+            }
+
+            auto refined = after.find(v);
+            if(refined == after.end() || !refined->second.isValid()) {
+                continue;
+            }
+
+            auto o = intervalOf(before, v);
+            const auto &r = refined->second;
+            if(r.getLeft() > o.getLeft()) {
+                facts.push_back({&bb, v, llvm::CmpInst::ICMP_SGE, r.getLeft()});
+            }
+            if(r.getRight() < o.getRight()) {
+                facts.push_back({&bb, v, llvm::CmpInst::ICMP_SLE, r.getRight()});
+            }
+        }
+    }
+
+    for(auto &fact : facts) {
+        llvm::IRBuilder<> builder(&*fact.bb->getFirstInsertionPt());
+        auto c = llvm::ConstantInt::get(fact.v->getType(), fact.bound);
+        builder.CreateAssumption(builder.CreateICmp(fact.predicate, fact.v, c));
+    }
+
+    return facts.size();
+}
+
+// turns conditional branches and switches whose condition is proven constant into unconditional branches,
+// then deletes the blocks left unreachable. returns the number of terminators folded
+inline unsigned foldBranches(llvm::Function &f, const IntervalAnalysis &analysis) {
+    if(!analysis.workList.empty()) {
+        return 0;
+    }
+
+    auto states = analysis.atAll();
+
+    std::vector<std::pair<llvm::Instruction*, llvm::APInt>> decided;
+    for(auto &bb : f) {
+        auto term = bb.getTerminator();
+
+        llvm::Value *cond = nullptr;
+        if(auto br = llvm::dyn_cast<llvm::BranchInst>(term); br && br->isConditional()) {
+            cond = br->getCondition();
+        } else if(auto sw = llvm::dyn_cast<llvm::SwitchInst>(term)) {
+            cond = sw->getCondition();
+        }
+
+        if(!cond || llvm::isa<llvm::Constant>(cond)) {
+            continue;
+        }
+
+        // blocks the analysis never reached have no state, and are left to the constant folding of their predecessors
+        const auto &symbols = states.at(&bb);
+        if(auto iter = symbols.find(cond); iter != symbols.end() && iter->second.isConstant()) {
+            decided.emplace_back(term, iter->second.getLeft());
+        }
+    }
+
+    // the analysis refers to blocks and values of the function, so rewriting waits until all are looked up
+    for(auto &[term, value] : decided) {
+        auto bb = term->getParent();
+        auto cond = term->getOperand(0);
+        auto c = llvm::ConstantInt::get(cond->getType(), value);
+
+        if(auto br = llvm::dyn_cast<llvm::BranchInst>(term)) {
+            br->setCondition(c);
+        } else {
+            llvm::cast<llvm::SwitchInst>(term)->setCondition(c);
+        }
+
+        llvm::ConstantFoldTerminator(bb, true);
+        llvm::RecursivelyDeleteTriviallyDeadInstructions(cond);
+    }
+
+    if(!decided.empty()) {
+        llvm::removeUnreachableBlocks(f);
+    }
+
+    return decided.size();
+}
+
+// the narrowest of i8, i16 and i32 below `width` that holds every value of `intervals`, 0 if there is none
+inline unsigned narrowestWidth(unsigned width, std::initializer_list<Interval> intervals) {
+    for(unsigned narrow : {8u, 16u, 32u}) {
+        if(narrow >= width) {
+            break;
+        }
+
+        if(std::all_of(intervals.begin(), intervals.end(), [narrow](const Interval &v) {
+            return v.isValid() && v.getLeft().getMinSignedBits() <= narrow && v.getRight().getMinSignedBits() <= narrow;
+        })) {
+            return narrow;
+        }
+    }
+
+    return 0;
+}
+
+// `v` as an integer of `width` bits, for a `v` known to hold only values of that width.
+// sign extensions are looked through, so narrowed chains stay narrow and only their ends are extended
+inline llvm::Value *narrowOperand(llvm::IRBuilder<> &builder, llvm::Value *v, unsigned width) {
+    auto ty = builder.getIntNTy(width);
+
+    if(auto ext = llvm::dyn_cast<llvm::SExtInst>(v); ext && ext->getSrcTy()->getIntegerBitWidth() <= width) {
+        return builder.CreateSExtOrTrunc(ext->getOperand(0), ty);
+    }
+
+    return builder.CreateTrunc(v, ty);
+}
+
+// shrinks slots, adds, subs, muls and comparisons to the narrowest of i8, i16 and i32 that holds
+// every value the analysis computed for them. narrowed results are sign extended back to their type
+// where they are used, chains of narrowed instructions read each other directly.
+// returns the number of slots and instructions narrowed
+inline unsigned narrowWidths(llvm::Function &f, const IntervalAnalysis &analysis) {
+    if(!analysis.workList.empty()) {
+        return 0;
+    }
+
+    auto states = analysis.atAll();
+
+    // all the intervals are looked up before anything is rewritten
+    std::map<llvm::AllocaInst*, unsigned> slotWidths;
+    std::map<llvm::Instruction*, unsigned> widths;
+
+    for(auto &bb : f) {
+        const auto &symbols = states.at(&bb);
+
+        for(auto &inst : bb) {
+            if(auto alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst); alloca && analysis.isSlot(alloca)) {
+                slotWidths.emplace(alloca, 8);
+            }
+            else if(auto store = llvm::dyn_cast<llvm::StoreInst>(&inst)) {
+                auto slot = llvm::dyn_cast<llvm::AllocaInst>(store->getPointerOperand());
+                if(!slot || !analysis.isSlot(slot)) {
+                    continue;
+                }
+
+                auto v = store->getValueOperand();
+                auto width = narrowestWidth(v->getType()->getIntegerBitWidth(), {intervalOf(symbols, v)});
+
+                auto &slotWidth = slotWidths[slot];
+                slotWidth = width ? std::max(slotWidth, width) : v->getType()->getIntegerBitWidth();
+            }
+            else if(inst.getType()->isIntegerTy() && (inst.getOpcode() == llvm::Instruction::Add ||
+                inst.getOpcode() == llvm::Instruction::Sub || inst.getOpcode() == llvm::Instruction::Mul)) {
+                if(auto width = narrowestWidth(inst.getType()->getIntegerBitWidth(), {intervalOf(symbols, &inst),
+                        intervalOf(symbols, inst.getOperand(0)), intervalOf(symbols, inst.getOperand(1))})) {
+                    widths.emplace(&inst, width);
+                }
+            }
+            else if(llvm::isa<llvm::ICmpInst>(inst) && inst.getOperand(0)->getType()->isIntegerTy()) {
+                if(auto width = narrowestWidth(inst.getOperand(0)->getType()->getIntegerBitWidth(),
+                        {intervalOf(symbols, inst.getOperand(0)), intervalOf(symbols, inst.getOperand(1))})) {
+                    widths.emplace(&inst, width);
+                }
+            }
+        }
+    }
+
+    unsigned changes = 0;
+
+    // slots only have plain loads and stores as users, see InductionLoop::isSlot
+    for(auto [slot, width] : slotWidths) {
+        auto ty = slot->getAllocatedType();
+        if(width >= ty->getIntegerBitWidth()) {
+            continue;
+        }
+
+        llvm::IRBuilder<> builder(slot);
+        auto narrow = builder.CreateAlloca(builder.getIntNTy(width), nullptr);
+        narrow->takeName(slot);
+
+        for(auto user : llvm::make_early_inc_range(slot->users())) {
+            auto inst = llvm::cast<llvm::Instruction>(user);
+            builder.SetInsertPoint(inst);
+
+            if(auto load = llvm::dyn_cast<llvm::LoadInst>(inst)) {
+                auto value = builder.CreateLoad(builder.getIntNTy(width), narrow);
+                load->replaceAllUsesWith(builder.CreateSExt(value, ty));
+                value->takeName(load);
+            } else {
+                auto store = llvm::cast<llvm::StoreInst>(inst);
+                builder.CreateStore(narrowOperand(builder, store->getValueOperand(), width), narrow);
+            }
+
+            inst->eraseFromParent();
+        }
+
+        slot->eraseFromParent();
+        changes++;
+    }
+
+    // operands are rewritten before their users, so users see their narrow form
+    llvm::ReversePostOrderTraversal<llvm::Function*> rpo(&f);
+    for(auto bb : rpo) {
+        for(auto &inst : llvm::make_early_inc_range(*bb)) {
+            auto iter = widths.find(&inst);
+            if(iter == widths.end()) {
+                continue;
+            }
+
+            llvm::IRBuilder<> builder(&inst);
+            auto width = iter->second;
+            auto l = narrowOperand(builder, inst.getOperand(0), width);
+            auto r = narrowOperand(builder, inst.getOperand(1), width);
+
+            llvm::Value *narrow, *result;
+            if(auto cmp = llvm::dyn_cast<llvm::ICmpInst>(&inst)) {
+                // sign extension keeps the signed and the unsigned order, so every predicate carries over
+                narrow = result = builder.CreateICmp(cmp->getPredicate(), l, r);
+            } else {
+                // the result fits, so the narrow operation cannot overflow
+                narrow = builder.CreateBinOp(static_cast<llvm::Instruction::BinaryOps>(inst.getOpcode()), l, r);
+                if(auto op = llvm::dyn_cast<llvm::BinaryOperator>(narrow)) {
+                    op->setHasNoSignedWrap();
+                }
+                result = builder.CreateSExt(narrow, inst.getType());
+            }
+
+            narrow->takeName(&inst);
+            inst.replaceAllUsesWith(result);
+            inst.eraseFromParent();
+            changes++;
+        }
+    }
+
+    return changes;
+}
+
+// applies the requested transforms to `f` with the results of its analysis, returns the number of changes.
+// folding deletes blocks the analysis refers to and narrowing replaces the instructions it refers to,
+// so they come last, and narrowing never looks up a value created after another one was freed
+inline unsigned applyTransforms(llvm::Function &f, const IntervalAnalysis &analysis, const TransformOptions &transforms) {
+    unsigned changes = 0;
+
+    if(transforms.annotateRanges) {
+        changes += annotateRanges(f, analysis);
+    }
+    if(transforms.annotateTripCounts) {
+        changes += annotateTripCounts(f, analysis);
+    }
+    if(transforms.inferNoWrap) {
+        changes += inferNoWrap(f, analysis);
+    }
+    if(transforms.insertAssumes) {
+        changes += insertAssumes(f, analysis);
+    }
+    if(transforms.foldBranches) {
+        changes += foldBranches(f, analysis);
+    }
+    if(transforms.narrowWidths) {
+        changes += narrowWidths(f, analysis);
+    }
+
+    return changes;
+}
+
+// function pass running the transforms on the results of IntervalAnalysisPass
+struct IntervalTransformPass : llvm::PassInfoMixin<IntervalTransformPass> {
+    TransformOptions transforms;
+
+    explicit IntervalTransformPass(const TransformOptions &transforms) : transforms(transforms) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &f, llvm::FunctionAnalysisManager &fam) {
+        if(!applyTransforms(f, fam.getResult<IntervalAnalysisPass>(f), transforms)) {
+            return llvm::PreservedAnalyses::all();
+        }
+
+        return llvm::PreservedAnalyses::none();
+    }
+};
+
+#endif //CODEPUNK_TRANSFORMS_H
@@ -0,0 +1,102 @@
+#ifndef CODEPUNK_TRIPCOUNTS_H
+#define CODEPUNK_TRIPCOUNTS_H
+
+#include <IntervalAnalysis.h>
+#include <llvm/IR/DebugInfoMetadata.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// proven bounds on how many times the body of an induction loop runs each time the loop is entered
+struct LoopTripCount {
+    InductionLoop loop;
+    uint64_t min = 0;
+    std::optional<uint64_t> max;
+};
+
+// trip counts of the induction loops of `f`, from the intervals of their compared values as the loops are entered.
+// loops whose compared slots could wrap around before the loop exits only get the trivial bounds
+inline std::vector<LoopTripCount> tripCounts(const llvm::Function &f, const IntervalAnalysis &analysis) {
+    std::vector<LoopTripCount> counts;
+    if(!analysis.workList.empty()) {
+        return counts;
+    }
+
+    for(auto &[header, loop] : InductionLoop::find(&f)) {
+        if(!analysis.constants.isExecutable(header)) {
+            continue;
+        }
+
+        LoopTripCount count;
+        count.loop = loop;
+        count.min = 0;
+        count.max = std::nullopt;
+
+        auto entry = analysis.merge(loop.entries, header);
+        auto valueOf = [&](const llvm::Value *v, const llvm::Value *slot) {
+            if(auto c = llvm::dyn_cast<llvm::ConstantInt>(v)) {
+                return Interval(c->getValue());
+            }
+            if(auto iter = entry.find(slot ? slot : v); iter != entry.end()) {
+                return analysis.table[iter->second];
+            }
+
+            return Interval::full(v->getType()->getIntegerBitWidth());
+        };
+
+        auto l0 = valueOf(loop.l, loop.lSlot), r0 = valueOf(loop.r, loop.rSlot);
+        auto trips = l0.isValid() && r0.isValid() ? loop.tripCount(l0, r0) : std::nullopt;
+
+        // a compared slot leaving its range means it wrapped around, and the count no longer holds
+        auto wraps = [&](const llvm::Value *slot, const Interval &v0) {
+            auto width = v0.getLeft().getBitWidth();
+            return slot && !loop.stepOf(slot, width).isNullValue() &&
+                loop.closedForm(slot, v0, trips->second).equals(Interval::full(width));
+        };
+
+        if(trips && !wraps(loop.lSlot, l0) && !wraps(loop.rSlot, r0) && trips->second.getActiveBits() <= 64) {
+            // other exits may leave the loop at any trip
+            count.min = loop.singleExit ? trips->first.getZExtValue() : 0;
+            count.max = trips->second.getZExtValue();
+        }
+
+        counts.push_back(std::move(count));
+    }
+
+    return counts;
+}
+
+// name of `bb` as it is printed in textual IR
+inline std::string blockName(const llvm::BasicBlock *bb) {
+    std::string name;
+    llvm::raw_string_ostream o(name);
+    bb->printAsOperand(o, false);
+
+    return o.str();
+}
+
+// one record per loop: {"function", "header", "line", "min", "max"},
+// "line" is only there with debug info and "max" is null for loops without an upper bound
+inline void printTripCounts(llvm::json::OStream &o, const llvm::Function &f, const std::vector<LoopTripCount> &counts) {
+    for(const auto &count : counts) {
+        o.object([&] {
+            o.attribute("function", f.getName());
+            o.attribute("header", blockName(count.loop.header));
+            if(auto &loc = count.loop.header->getTerminator()->getDebugLoc()) {
+                o.attribute("line", int64_t(loc.getLine()));
+            }
+            o.attribute("min", int64_t(count.min));
+            if(count.max && *count.max <= uint64_t(INT64_MAX)) {
+                o.attribute("max", int64_t(*count.max));
+            } else {
+                o.attribute("max", nullptr);
+            }
+        });
+    }
+}
+
+#endif //CODEPUNK_TRIPCOUNTS_H
@@ -0,0 +1,110 @@
+#ifndef CODEPUNK_C_API_H
+#define CODEPUNK_C_API_H
+
+/*
+ * C interface of libcodepunk: load a module from memory, analyze its functions and read the
+ * resulting intervals as plain structs, without spawning codepunk and parsing its output.
+ *
+ * the ABI only ever grows: structs start with their own size as the caller knows it, new fields are appended,
+ * and CODEPUNK_API_VERSION is bumped whenever something is added. structs are only ever passed by pointer,
+ * one at a time, so a caller built against an older header never sees a stride it does not know.
+ * a module and the results taken from it may be used from one thread at a time,
+ * different modules are independent of each other.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define CODEPUNK_API __declspec(dllexport)
+#else
+#define CODEPUNK_API __attribute__((visibility("default")))
+#endif
+
+#define CODEPUNK_API_VERSION 1
+
+typedef struct codepunk_module codepunk_module;
+typedef struct codepunk_result codepunk_result;
+
+typedef struct codepunk_options {
+    /* sizeof(codepunk_options) as the caller knows it */
+    uint32_t size;
+    /* max number of iterations, -1 for no limit */
+    int32_t max_iteration;
+    uint8_t checkpoint_states;
+    uint8_t tiered;
+    uint8_t accelerate_loops;
+    uint8_t prune_dead;
+    /* per-function budgets, 0 for unlimited */
+    uint32_t budget_iterations;
+    uint32_t budget_ms;
+    uint64_t budget_memory;
+} codepunk_options;
+
+/* the interval of a value at the end of a block */
+typedef struct codepunk_fact {
+    /* sizeof(codepunk_fact) as the caller knows it */
+    uint32_t size;
+    /* index of the block in its function */
+    uint32_t block;
+    /* index of the value in its function: the arguments, then the instructions in order */
+    uint32_t value;
+    /* bit width of the value, bounds are signed */
+    uint32_t width;
+    /* whether lo and hi hold the bounds, read them with codepunk_fact_bounds otherwise */
+    uint8_t fits_int64;
+    int64_t lo;
+    int64_t hi;
+} codepunk_fact;
+
+CODEPUNK_API uint32_t codepunk_api_version(void);
+
+/* the defaults of the codepunk command line */
+CODEPUNK_API void codepunk_options_init(codepunk_options *options);
+
+/* parses textual IR or bitcode from the `size` bytes at data, which need not be NUL-terminated.
+ * returns NULL on failure and, if error is not NULL,
+ * stores a message there to be released with codepunk_string_free */
+CODEPUNK_API codepunk_module *codepunk_module_load(const char *data, size_t size, const char *name, char **error);
+CODEPUNK_API void codepunk_module_free(codepunk_module *module);
+
+/* functions with a body, in module order */
+CODEPUNK_API size_t codepunk_module_function_count(const codepunk_module *module);
+CODEPUNK_API const char *codepunk_module_function_name(const codepunk_module *module, size_t function);
+
+/* names are empty for unnamed blocks and values */
+CODEPUNK_API size_t codepunk_function_block_count(const codepunk_module *module, size_t function);
+CODEPUNK_API const char *codepunk_function_block_name(const codepunk_module *module, size_t function, uint32_t block);
+CODEPUNK_API size_t codepunk_function_value_count(const codepunk_module *module, size_t function);
+CODEPUNK_API const char *codepunk_function_value_name(const codepunk_module *module, size_t function, uint32_t value);
+
+/* analyzes a function, options may be NULL for the defaults. returns NULL if function is out of range */
+CODEPUNK_API codepunk_result *codepunk_analyze(const codepunk_module *module, size_t function,
+        const codepunk_options *options);
+CODEPUNK_API void codepunk_result_free(codepunk_result *result);
+
+/* facts ordered by block, then value */
+CODEPUNK_API size_t codepunk_result_fact_count(const codepunk_result *result);
+
+/* copies fact number `fact` into out, as much of it as out->size says the caller knows.
+ * returns 0 if fact is out of range */
+CODEPUNK_API int codepunk_result_fact(const codepunk_result *result, size_t fact, codepunk_fact *out);
+
+/* non-zero if a budget ran out and the result is coarser than the fixpoint */
+CODEPUNK_API int codepunk_result_degraded(const codepunk_result *result);
+
+/* writes the bounds of a fact as (width + 7) / 8 byte little-endian two's complement integers
+ * to lo and hi, either may be NULL. returns the number of bytes per bound */
+CODEPUNK_API size_t codepunk_fact_bounds(const codepunk_result *result, size_t fact, uint8_t *lo, uint8_t *hi);
+
+CODEPUNK_API void codepunk_string_free(char *string);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CODEPUNK_C_API_H */
@@ -0,0 +1,268 @@
+#include <codepunk.h>
+#include <Driver.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+// a function with its blocks and values numbered the way facts refer to them
+struct FunctionInfo {
+    const Function *function;
+    std::string name;
+
+    std::vector<const BasicBlock*> blocks;
+    std::vector<std::string> blockNames;
+    std::map<const Value*, uint32_t> valueIndex;
+    std::vector<std::string> valueNames;
+
+    explicit FunctionInfo(const Function &f) : function(&f), name(f.getName().str()) {
+        for(const auto &arg : f.args()) {
+            addValue(&arg);
+        }
+        for(const auto &bb : f) {
+            blocks.push_back(&bb);
+            blockNames.push_back(bb.getName().str());
+            for(const auto &inst : bb) {
+                addValue(&inst);
+            }
+        }
+    }
+
+    void addValue(const Value *v) {
+        valueIndex.emplace(v, valueNames.size());
+        valueNames.push_back(v->getName().str());
+    }
+};
+
+char *copyString(const std::string &s) {
+    auto res = static_cast<char*>(std::malloc(s.size() + 1));
+    if(res) {
+        std::memcpy(res, s.c_str(), s.size() + 1);
+    }
+
+    return res;
+}
+
+// little-endian two's complement, sign extended to fill `bytes`
+void writeBytes(const APInt &v, uint8_t *out, size_t bytes) {
+    auto extended = v.sextOrSelf(bytes * 8);
+    for(size_t i = 0; i < bytes; i++) {
+        out[i] = uint8_t(extended.extractBitsAsZExtValue(8, i * 8));
+    }
+}
+
+}
+
+struct codepunk_module {
+    LLVMContext ctx;
+    std::unique_ptr<Module> mod;
+    std::vector<FunctionInfo> functions;
+};
+
+struct codepunk_result {
+    std::vector<codepunk_fact> facts;
+    std::vector<APInt> lo, hi;
+    bool degraded = false;
+};
+
+extern "C" {
+
+uint32_t codepunk_api_version(void) {
+    return CODEPUNK_API_VERSION;
+}
+
+void codepunk_options_init(codepunk_options *options) {
+    IntervalAnalysisOptions defaults;
+
+    *options = codepunk_options{};
+    options->size = sizeof(codepunk_options);
+    options->max_iteration = -1;
+    options->checkpoint_states = defaults.checkpointOnly;
+    options->tiered = defaults.tiered;
+    options->accelerate_loops = defaults.accelerateLoops;
+    options->prune_dead = defaults.pruneDead;
+    options->budget_iterations = defaults.iterationBudget;
+    options->budget_ms = defaults.timeBudgetMs;
+    options->budget_memory = defaults.memoryBudget;
+}
+
+codepunk_module *codepunk_module_load(const char *data, size_t size, const char *name, char **error) {
+    auto module = std::make_unique<codepunk_module>();
+
+    // the IR lexer reads up to a terminating NUL, which the caller's `size` bytes need not have
+    auto buffer = MemoryBuffer::getMemBufferCopy(StringRef(data, size), name ? name : "<memory>");
+
+    std::string message;
+    module->mod = parseModule(buffer->getMemBufferRef(), module->ctx, message);
+    if(!module->mod) {
+        if(error) {
+            *error = copyString(message);
+        }
+        return nullptr;
+    }
+
+    for(const auto &f : *module->mod) {
+        if(!f.isDeclaration()) {
+            module->functions.emplace_back(f);
+        }
+    }
+
+    return module.release();
+}
+
+void codepunk_module_free(codepunk_module *module) {
+    delete module;
+}
+
+size_t codepunk_module_function_count(const codepunk_module *module) {
+    return module->functions.size();
+}
+
+const char *codepunk_module_function_name(const codepunk_module *module, size_t function) {
+    return function < module->functions.size() ? module->functions[function].name.c_str() : nullptr;
+}
+
+size_t codepunk_function_block_count(const codepunk_module *module, size_t function) {
+    return function < module->functions.size() ? module->functions[function].blocks.size() : 0;
+}
+
+const char *codepunk_function_block_name(const codepunk_module *module, size_t function, uint32_t block) {
+    if(function >= module->functions.size() || block >= module->functions[function].blockNames.size()) {
+        return nullptr;
+    }
+
+    return module->functions[function].blockNames[block].c_str();
+}
+
+size_t codepunk_function_value_count(const codepunk_module *module, size_t function) {
+    return function < module->functions.size() ? module->functions[function].valueNames.size() : 0;
+}
+
+const char *codepunk_function_value_name(const codepunk_module *module, size_t function, uint32_t value) {
+    if(function >= module->functions.size() || value >= module->functions[function].valueNames.size()) {
+        return nullptr;
+    }
+
+    return module->functions[function].valueNames[value].c_str();
+}
+
+codepunk_result *codepunk_analyze(const codepunk_module *module, size_t function, const codepunk_options *options) {
+    if(function >= module->functions.size()) {
+        return nullptr;
+    }
+
+    codepunk_options given;
+    codepunk_options_init(&given);
+    if(options) {
+        // callers built against an older header pass a shorter struct, the rest keeps the defaults
+        std::memcpy(&given, options, std::min<size_t>(options->size, sizeof(codepunk_options)));
+    }
+
+    IntervalAnalysisOptions analysisOptions;
+    analysisOptions.checkpointOnly = given.checkpoint_states;
+    analysisOptions.tiered = given.tiered;
+    analysisOptions.accelerateLoops = given.accelerate_loops;
+    analysisOptions.pruneDead = given.prune_dead;
+    analysisOptions.iterationBudget = given.budget_iterations;
+    analysisOptions.timeBudgetMs = given.budget_ms;
+    analysisOptions.memoryBudget = given.budget_memory;
+
+    const auto &info = module->functions[function];
+    IntervalAnalysis analysis(info.function, analysisOptions);
+    analysis.analyze(given.max_iteration);
+
+    auto result = std::make_unique<codepunk_result>();
+    result->degraded = analysis.exhausted != IntervalAnalysis::None;
+
+    auto states = analysis.atAll();
+    for(uint32_t block = 0; block < info.blocks.size(); block++) {
+        std::vector<std::pair<uint32_t, const Interval*>> values;
+
+        const auto &symbols = states.at(info.blocks[block]);
+        for(const auto &[v, interval] : symbols) {
+            // constants and globals are not numbered, and invalid intervals have no value to report
+            auto iter = info.valueIndex.find(v);
+            if(iter != info.valueIndex.end() && interval.isValid()) {
+                values.emplace_back(iter->second, &interval);
+            }
+        }
+        std::sort(values.begin(), values.end());
+
+        for(auto [value, interval] : values) {
+            const auto &lo = interval->getLeft(), &hi = interval->getRight();
+
+            codepunk_fact fact{};
+            fact.size = sizeof(codepunk_fact);
+            fact.block = block;
+            fact.value = value;
+            fact.width = lo.getBitWidth();
+            fact.fits_int64 = lo.getMinSignedBits() <= 64 && hi.getMinSignedBits() <= 64;
+            if(fact.fits_int64) {
+                fact.lo = lo.getSExtValue();
+                fact.hi = hi.getSExtValue();
+            }
+
+            result->facts.push_back(fact);
+            result->lo.push_back(lo);
+            result->hi.push_back(hi);
+        }
+    }
+
+    return result.release();
+}
+
+void codepunk_result_free(codepunk_result *result) {
+    delete result;
+}
+
+size_t codepunk_result_fact_count(const codepunk_result *result) {
+    return result->facts.size();
+}
+
+int codepunk_result_fact(const codepunk_result *result, size_t fact, codepunk_fact *out) {
+    if(fact >= result->facts.size()) {
+        return 0;
+    }
+
+    // callers built against an older header know a shorter struct, the size they set stays theirs
+    auto size = out->size;
+    std::memcpy(out, &result->facts[fact], std::min<size_t>(size, sizeof(codepunk_fact)));
+    out->size = size;
+
+    return 1;
+}
+
+int codepunk_result_degraded(const codepunk_result *result) {
+    return result->degraded;
+}
+
+size_t codepunk_fact_bounds(const codepunk_result *result, size_t fact, uint8_t *lo, uint8_t *hi) {
+    if(fact >= result->facts.size()) {
+        return 0;
+    }
+
+    size_t bytes = (result->facts[fact].width + 7) / 8;
+    if(lo) {
+        writeBytes(result->lo[fact], lo, bytes);
+    }
+    if(hi) {
+        writeBytes(result->hi[fact], hi, bytes);
+    }
+
+    return bytes;
+}
+
+void codepunk_string_free(char *string) {
+    std::free(string);
+}
+
+}
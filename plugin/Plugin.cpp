@@ -0,0 +1,86 @@
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/PassPlugin.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Config/llvm-config.h>
+
+#include "IntervalAnalysisPass.h"
+#include "Transforms.h"
+
+#include <map>
+
+using namespace llvm;
+
+static cl::opt<int> MaxIteration("codepunk-iterate", cl::desc("max iteration count of codepunk interval analysis"),
+        cl::value_desc("number"), cl::init(-1));
+static cl::opt<bool> CheckpointStates("codepunk-checkpoint-states",
+        cl::desc("keep codepunk block states only at join points, loop heads and exits"));
+static cl::opt<bool> Tiered("codepunk-tiered",
+        cl::desc("run the codepunk triage pass first and the full fixpoint only where it is needed"));
+static cl::opt<bool> AccelerateLoops("codepunk-accelerate-loops",
+        cl::desc("evaluate simple induction loops in closed form in codepunk interval analysis"), cl::init(true));
+static cl::opt<bool> PruneDead("codepunk-prune-dead",
+        cl::desc("drop values from codepunk block states once they are no longer live"));
+static cl::opt<unsigned> IterationBudget("codepunk-budget-iterations",
+        cl::desc("codepunk per-function iteration budget before degrading to a coarse result (0 for unlimited)"),
+        cl::value_desc("number"), cl::init(0));
+static cl::opt<unsigned> TimeBudget("codepunk-budget-ms",
+        cl::desc("codepunk per-function wall-clock budget in milliseconds (0 for unlimited)"),
+        cl::value_desc("milliseconds"), cl::init(0));
+static cl::opt<size_t> MemoryBudget("codepunk-budget-memory",
+        cl::desc("codepunk per-function budget on abstract state memory in bytes (0 for unlimited)"),
+        cl::value_desc("bytes"), cl::init(0));
+
+static IntervalAnalysisOptions analysisOptions() {
+    IntervalAnalysisOptions options;
+    options.checkpointOnly = CheckpointStates;
+    options.tiered = Tiered;
+    options.accelerateLoops = AccelerateLoops;
+    options.pruneDead = PruneDead;
+    options.iterationBudget = IterationBudget;
+    options.timeBudgetMs = TimeBudget;
+    options.memoryBudget = MemoryBudget;
+
+    return options;
+}
+
+// transform passes by pipeline name, each runs a single transform
+static const std::map<StringRef, bool TransformOptions::*> TransformPasses = {
+        {"codepunk-annotate-ranges", &TransformOptions::annotateRanges},
+        {"codepunk-annotate-trip-counts", &TransformOptions::annotateTripCounts},
+        {"codepunk-infer-no-wrap", &TransformOptions::inferNoWrap},
+        {"codepunk-insert-assumes", &TransformOptions::insertAssumes},
+        {"codepunk-fold-branches", &TransformOptions::foldBranches},
+        {"codepunk-narrow-widths", &TransformOptions::narrowWidths},
+};
+
+static bool parsePipeline(StringRef name, FunctionPassManager &fpm, ArrayRef<PassBuilder::PipelineElement>) {
+    if(name == "print<codepunk-interval>") {
+        fpm.addPass(IntervalAnalysisPrinterPass(errs()));
+        return true;
+    }
+    if(auto iter = TransformPasses.find(name); iter != TransformPasses.end()) {
+        TransformOptions transforms;
+        transforms.*iter->second = true;
+        fpm.addPass(IntervalTransformPass(transforms));
+        return true;
+    }
+    if(name == "require<codepunk-interval>") {
+        fpm.addPass(RequireAnalysisPass<IntervalAnalysisPass, Function>());
+        return true;
+    }
+    if(name == "invalidate<codepunk-interval>") {
+        fpm.addPass(InvalidateAnalysisPass<IntervalAnalysisPass>());
+        return true;
+    }
+
+    return false;
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+    return {LLVM_PLUGIN_API_VERSION, "codepunk", LLVM_VERSION_STRING, [](PassBuilder &pb) {
+        pb.registerAnalysisRegistrationCallback([](FunctionAnalysisManager &fam) {
+            fam.registerPass([] { return IntervalAnalysisPass(MaxIteration, analysisOptions()); });
+        });
+        pb.registerPipelineParsingCallback(parsePipeline);
+    }};
+}
@@ -1,84 +1,297 @@
 #include <string>
+#include <thread>
+#include <sys/resource.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/Support/CommandLine.h>
-#include <llvm/IRReader/IRReader.h>
-#include <llvm/IR/LLVMContext.h>
-#include <llvm/IR/Module.h>
-#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/ToolOutputFile.h>
 #include <llvm/Support/raw_ostream.h>
 
-#include "IntervalAnalysis.h"
+#include "BatchDriver.h"
+#include "Snapshot.h"
 
 using namespace llvm;
 
-static cl::opt<std::string> InputFilename(cl::Positional, cl::desc("filename of LLVM IR input"));
+static cl::list<std::string> InputFilenames(cl::Positional,
+        cl::desc("filenames of LLVM IR input, directories or @response-files"));
 static cl::opt<int> MaxIteration("iterate", cl::desc("max iteration count"),
         cl::value_desc("number"), cl::init(-1));
+static cl::opt<bool> CheckpointStates("checkpoint-states",
+        cl::desc("keep block states only at join points, loop heads and exits to save memory"));
+static cl::opt<bool> Tiered("tiered",
+        cl::desc("run a linear triage pass first and the full fixpoint only where it is needed"));
+static cl::opt<bool> AccelerateLoops("accelerate-loops",
+        cl::desc("evaluate simple induction loops in closed form instead of iterating them"), cl::init(true));
+static cl::opt<bool> PruneDead("prune-dead",
+        cl::desc("drop values from block states once they are no longer live"));
+static cl::opt<unsigned> IterationBudget("budget-iterations",
+        cl::desc("per-function iteration budget before degrading to a coarse result (0 for unlimited)"),
+        cl::value_desc("number"), cl::init(0));
+static cl::opt<unsigned> TimeBudget("budget-ms",
+        cl::desc("per-function wall-clock budget in milliseconds (0 for unlimited)"),
+        cl::value_desc("milliseconds"), cl::init(0));
+static cl::opt<size_t> MemoryBudget("budget-memory",
+        cl::desc("per-function budget on abstract state memory in bytes (0 for unlimited)"),
+        cl::value_desc("bytes"), cl::init(0));
+static cl::opt<AnalysisDomain> Domain("domain", cl::desc("abstract domain of the analysis"),
+        cl::values(clEnumValN(AnalysisDomain::Interval, "interval", "intervals with closed-form loops (default)"),
+                   clEnumValN(AnalysisDomain::WidenedInterval, "interval-widen", "intervals widened at loop heads"),
+                   clEnumValN(AnalysisDomain::Constant, "constant", "single constants"),
+                   clEnumValN(AnalysisDomain::Sign, "sign", "signs of values")),
+        cl::init(AnalysisDomain::Interval));
+static cl::opt<bool> AnnotateRanges("annotate-ranges",
+        cl::desc("attach !range metadata to integer loads and write out the module"));
+static cl::opt<bool> InferNoWrap("infer-no-wrap",
+        cl::desc("set nsw/nuw on arithmetic proven not to overflow and write out the module"));
+static cl::opt<bool> InsertAssumes("insert-assumes",
+        cl::desc("insert llvm.assume for the bounds branch conditions refine and write out the module"));
+static cl::opt<bool> FoldBranches("fold-branches",
+        cl::desc("fold branches decided by the analysis, delete the blocks left unreachable and write out the module"));
+static cl::opt<bool> NarrowWidths("narrow-widths",
+        cl::desc("shrink slots, arithmetic and comparisons to the narrowest integer type holding their values "
+                 "and write out the module"));
+static cl::opt<bool> AnnotateTripCounts("annotate-trip-counts",
+        cl::desc("record proven trip counts of induction loops in their llvm.loop metadata and write out the module"));
+static cl::opt<std::string> TripCountReport("trip-count-report",
+        cl::desc("write the proven trip counts of all induction loops as a JSON array to a file"),
+        cl::value_desc("filename"));
+static cl::opt<std::string> OutputFilename("o", cl::desc("output file of the transformed module"),
+        cl::value_desc("filename"), cl::init("-"));
+static cl::opt<bool> OutputAssembly("S", cl::desc("write the transformed module as textual IR instead of bitcode"));
+static cl::opt<std::string> MemoryReport("memory-report",
+        cl::desc("write the bytes each analysis held per subsystem and phase as JSON to a file"),
+        cl::value_desc("filename"));
+static cl::opt<size_t> MemoryWarning("memory-warn",
+        cl::desc("warn about functions whose analysis held more than this many bytes at once (0 to never warn)"),
+        cl::value_desc("bytes"), cl::init(0));
+static cl::opt<std::string> SnapshotFilename("snapshot",
+        cl::desc("checkpoint the analysis to a snapshot file, resuming from it if it already holds progress"),
+        cl::value_desc("filename"));
+static cl::opt<unsigned> SnapshotInterval("snapshot-interval",
+        cl::desc("iterations between checkpoints of a function, 0 to only checkpoint finished functions"),
+        cl::value_desc("number"), cl::init(10000));
+static cl::opt<unsigned> Jobs("j", cl::desc("number of parallel parse/analysis jobs (0 for one per core)"),
+        cl::value_desc("number"), cl::init(0));
 
-raw_ostream &operator<<(raw_ostream& o, const Value *v) {
-    if(v->hasName()) {
-        return o << v->getName() << " <" << (void *)v << ">";
+static int transformInput(const std::vector<std::string>& inputs, const DriverOptions& options,
+        const TransformOptions& transforms) {
+    if(inputs.size() != 1) {
+        errs() << "transforms take exactly one input\n";
+        return 1;
     }
-    if(auto c = dyn_cast<Constant>(v)) {
-        return o << c->getUniqueInteger() << " <" << (void *)v << ">";
+
+    auto buffer = MemoryBuffer::getFileOrSTDIN(inputs.front());
+    if(!buffer) {
+        errs() << inputs.front() << ": " << buffer.getError().message() << "\n";
+        return 1;
     }
 
-    return o << (void *)v;
-}
+    LLVMContext ctx;
+    std::string error;
+    auto mod = parseModule(buffer.get()->getMemBufferRef(), ctx, error);
+    if(!mod) {
+        errs() << inputs.front() << ": " << error << "\n";
+        return 1;
+    }
+
+    transformModule(*mod, options, transforms);
+
+    std::error_code ec;
+    ToolOutputFile out(OutputFilename, ec, OutputAssembly ? sys::fs::OF_Text : sys::fs::OF_None);
+    if(ec) {
+        errs() << OutputFilename << ": " << ec.message() << "\n";
+        return 1;
+    }
+
+    if(OutputAssembly) {
+        mod->print(out.os(), nullptr);
+    } else {
+        WriteBitcodeToFile(*mod, out.os());
+    }
 
-void analyze(const Function* f, int maxIteration) {
-    IntervalAnalysis analysis(f);
-    analysis.analyze(maxIteration);
+    out.keep();
+    return 0;
+}
 
-    outs() << f->getName() << ":\n";
-    for(const auto& v : f->args()) {
-        outs() << "  | " << &v;
+static int reportTripCounts(const std::vector<std::string>& inputs, const DriverOptions& options) {
+    std::error_code ec;
+    ToolOutputFile out(TripCountReport, ec, sys::fs::OF_Text);
+    if(ec) {
+        errs() << TripCountReport << ": " << ec.message() << "\n";
+        return 1;
     }
-    outs() << "\n";
-    for(const auto& bb : f->getBasicBlockList()) {
-        outs() << "  [" << &bb << "]\n";
 
-        for(const auto& inst : bb.getInstList()) {
-            outs() << "\t" << inst.getOpcodeName() << " (";
-            bool isF = true;
-            for(const auto& v : inst.operands()) {
-                if(isF) isF = false;
-                else outs() << ", ";
+    json::OStream o(out.os(), 2);
+    int res = 0;
 
-                outs() << v;
+    o.array([&] {
+        for(const auto& input : inputs) {
+            auto buffer = MemoryBuffer::getFileOrSTDIN(input);
+            if(!buffer) {
+                errs() << input << ": " << buffer.getError().message() << "\n";
+                res = 1;
+                continue;
             }
-            outs() << ")->" << &inst << "\n";
-        }
 
-        outs() << "  \t" << std::string(50, '-') << "\n";
+            LLVMContext ctx;
+            std::string error;
+            auto mod = parseModule(buffer.get()->getMemBufferRef(), ctx, error);
+            if(!mod) {
+                errs() << input << ": " << error << "\n";
+                res = 1;
+                continue;
+            }
 
-        const auto res = analysis.dataMap.at(&bb);
-        for(const auto &j : res) {
-            outs() << "\t" << j.first << " : " << j.second << "\n";
+            reportTripCounts(*mod, options, o);
         }
+    });
+
+    out.os() << "\n";
+    out.keep();
+    return res;
+}
+
+static int64_t peakResidentBytes() {
+    struct rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+
+    // kilobytes on linux
+    return int64_t(usage.ru_maxrss) * 1024;
+}
+
+// analyzes the inputs one after the other, so that the heap growth while parsing is the module's own
+static int reportMemory(const std::vector<std::string>& inputs, const DriverOptions& options) {
+    std::error_code ec;
+    ToolOutputFile out(MemoryReport, ec, sys::fs::OF_Text);
+    if(ec) {
+        errs() << MemoryReport << ": " << ec.message() << "\n";
+        return 1;
     }
+
+    json::OStream o(out.os(), 2);
+    int res = 0;
+
+    o.object([&] {
+        o.attributeArray("modules", [&] {
+            for(const auto& input : inputs) {
+                auto buffer = MemoryBuffer::getFileOrSTDIN(input);
+                if(!buffer) {
+                    errs() << input << ": " << buffer.getError().message() << "\n";
+                    res = 1;
+                    continue;
+                }
+
+                LLVMContext ctx;
+                std::string error;
+                auto before = sys::Process::GetMallocUsage();
+                auto mod = parseModule(buffer.get()->getMemBufferRef(), ctx, error);
+                if(!mod) {
+                    errs() << input << ": " << error << "\n";
+                    res = 1;
+                    continue;
+                }
+
+                o.object([&] {
+                    o.attribute("module", input);
+                    o.attribute("module_bytes", int64_t(sys::Process::GetMallocUsage() - before));
+                    o.attributeArray("functions", [&] {
+                        reportMemory(*mod, options, o, errs());
+                    });
+                });
+            }
+        });
+        o.attribute("peak_rss", peakResidentBytes());
+    });
+
+    out.os() << "\n";
+    out.keep();
+    return res;
+}
+
+static int analyzeResumable(const std::vector<std::string>& inputs, const DriverOptions& options) {
+    if(inputs.size() != 1) {
+        errs() << "snapshots take exactly one input\n";
+        return 1;
+    }
+
+    auto buffer = MemoryBuffer::getFileOrSTDIN(inputs.front());
+    if(!buffer) {
+        errs() << inputs.front() << ": " << buffer.getError().message() << "\n";
+        return 1;
+    }
+
+    LLVMContext ctx;
+    std::string error;
+    auto mod = parseModule(buffer.get()->getMemBufferRef(), ctx, error);
+    if(!mod) {
+        errs() << inputs.front() << ": " << error << "\n";
+        return 1;
+    }
+
+    return analyzeModuleResumable(*mod, options, SnapshotFilename, SnapshotInterval, outs(), errs()) ? 0 : 1;
 }
 
 int main(int argc, char *argv[]) {
     cl::ParseCommandLineOptions(argc, argv);
 
-    if(InputFilename.empty()) {
+    if(InputFilenames.empty()) {
         errs() << "filename is expected";
         abort();
     }
 
-    LLVMContext ctx;
-    SMDiagnostic diag;
+    DriverOptions options;
+    options.maxIteration = MaxIteration;
+    options.analysis.checkpointOnly = CheckpointStates;
+    options.analysis.tiered = Tiered;
+    options.analysis.accelerateLoops = AccelerateLoops;
+    options.analysis.pruneDead = PruneDead;
+    options.analysis.iterationBudget = IterationBudget;
+    options.analysis.timeBudgetMs = TimeBudget;
+    options.analysis.memoryBudget = MemoryBudget;
+    options.memoryWarning = MemoryWarning;
+    options.domain = Domain;
 
-    auto mod = parseIRFile(InputFilename, diag, ctx);
+    TransformOptions transforms;
+    transforms.annotateRanges = AnnotateRanges;
+    transforms.annotateTripCounts = AnnotateTripCounts;
+    transforms.inferNoWrap = InferNoWrap;
+    transforms.insertAssumes = InsertAssumes;
+    transforms.foldBranches = FoldBranches;
+    transforms.narrowWidths = NarrowWidths;
 
-    if(auto msg = diag.getMessage(); !msg.empty()) {
-        errs() << msg;
-        abort();
+    // only the printed analysis runs in other domains, everything else needs the interval engine
+    if(options.domain != AnalysisDomain::Interval &&
+        (transforms.any() || !SnapshotFilename.empty() || !TripCountReport.empty() || !MemoryReport.empty())) {
+        errs() << "-domain=" << domainName(options.domain)
+               << " cannot be combined with transforms, snapshots or reports\n";
+        return 1;
     }
 
-    const auto& funcList = mod->getFunctionList();
+    auto inputs = collectInputs(InputFilenames, errs());
+
+    if(!TripCountReport.empty()) {
+        if(int res = reportTripCounts(inputs, options)) {
+            return res;
+        }
+    }
+    if(!MemoryReport.empty()) {
+        if(int res = reportMemory(inputs, options)) {
+            return res;
+        }
+    }
 
-    for(const auto& func : funcList) {
-        analyze(&func, MaxIteration);
+    if(transforms.any()) {
+        return transformInput(inputs, options, transforms);
     }
+    if(!TripCountReport.empty() || !MemoryReport.empty()) {
+        return 0;
+    }
+
+    if(!SnapshotFilename.empty()) {
+        return analyzeResumable(inputs, options);
+    }
+
+    BatchDriver driver(options, Jobs ? Jobs : std::thread::hardware_concurrency());
+
+    return driver.run(inputs, outs(), errs()) ? 1 : 0;
 }
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <codepunk.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+static const char *CApiIR = R"(
+declare i32 @g()
+
+define i32 @f(i32 %x) {
+entry:
+  %c = icmp sgt i32 %x, -1
+  br i1 %c, label %positive, label %exit
+
+positive:
+  %d = icmp slt i32 %x, 16
+  br i1 %d, label %small, label %exit
+
+small:
+  %b = add i32 %x, 1
+  ret i32 %b
+
+exit:
+  ret i32 0
+}
+
+define i128 @wide() {
+entry:
+  %w = add i128 1267650600228229401496703205376, 1
+  ret i128 %w
+}
+)";
+
+// the index of the fact for the value named `name` at the end of block `block`, copied to `out`
+static size_t findFact(const codepunk_module *module, size_t function, const codepunk_result *result,
+        uint32_t block, const char *name, codepunk_fact &out) {
+    out.size = sizeof(codepunk_fact);
+    for(size_t i = 0; codepunk_result_fact(result, i, &out); i++) {
+        if(out.block == block && !std::strcmp(codepunk_function_value_name(module, function, out.value), name)) {
+            return i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+TEST(CApi, Analyze) {
+    ASSERT_EQ(codepunk_api_version(), uint32_t(CODEPUNK_API_VERSION));
+
+    auto module = codepunk_module_load(CApiIR, std::strlen(CApiIR), "capi", nullptr);
+    ASSERT_NE(module, nullptr);
+
+    // declarations are left out
+    ASSERT_EQ(codepunk_module_function_count(module), 2u);
+    ASSERT_STREQ(codepunk_module_function_name(module, 0), "f");
+    ASSERT_EQ(codepunk_function_block_count(module, 0), 4u);
+    ASSERT_STREQ(codepunk_function_block_name(module, 0, 2), "small");
+    // %x, %c, br, %d, br, %b, ret, ret
+    ASSERT_EQ(codepunk_function_value_count(module, 0), 8u);
+    ASSERT_STREQ(codepunk_function_value_name(module, 0, 0), "x");
+    ASSERT_EQ(codepunk_function_value_name(module, 0, 8), nullptr);
+
+    codepunk_options options;
+    codepunk_options_init(&options);
+    auto result = codepunk_analyze(module, 0, &options);
+    ASSERT_NE(result, nullptr);
+    ASSERT_FALSE(codepunk_result_degraded(result));
+
+    codepunk_fact b;
+    auto index = findFact(module, 0, result, 2, "b", b);
+    ASSERT_LT(index, codepunk_result_fact_count(result));
+    ASSERT_EQ(b.size, sizeof(codepunk_fact));
+    ASSERT_EQ(b.width, 32u);
+    ASSERT_TRUE(b.fits_int64);
+    ASSERT_EQ(b.lo, 1);
+    ASSERT_EQ(b.hi, 16);
+
+    // a caller knowing a shorter struct only gets the fields it knows
+    codepunk_fact shorter{};
+    shorter.size = offsetof(codepunk_fact, width);
+    ASSERT_TRUE(codepunk_result_fact(result, index, &shorter));
+    ASSERT_EQ(shorter.size, offsetof(codepunk_fact, width));
+    ASSERT_EQ(shorter.value, b.value);
+    ASSERT_EQ(shorter.width, 0u);
+    ASSERT_FALSE(codepunk_result_fact(result, codepunk_result_fact_count(result), &shorter));
+
+    uint8_t lo[4], hi[4];
+    ASSERT_EQ(codepunk_fact_bounds(result, index, lo, hi), 4u);
+    ASSERT_EQ(lo[0], 1);
+    ASSERT_EQ(hi[0], 16);
+    ASSERT_EQ(hi[3], 0);
+    codepunk_result_free(result);
+
+    ASSERT_EQ(codepunk_analyze(module, 2, nullptr), nullptr);
+    codepunk_module_free(module);
+}
+
+TEST(CApi, WideBounds) {
+    auto module = codepunk_module_load(CApiIR, std::strlen(CApiIR), nullptr, nullptr);
+    ASSERT_NE(module, nullptr);
+
+    auto result = codepunk_analyze(module, 1, nullptr);
+    ASSERT_NE(result, nullptr);
+
+    // 2^100 + 1 does not fit in 64 bits
+    codepunk_fact w;
+    auto index = findFact(module, 1, result, 0, "w", w);
+    ASSERT_LT(index, codepunk_result_fact_count(result));
+    ASSERT_EQ(w.width, 128u);
+    ASSERT_FALSE(w.fits_int64);
+
+    uint8_t lo[16], hi[16];
+    ASSERT_EQ(codepunk_fact_bounds(result, index, lo, hi), 16u);
+    ASSERT_EQ(std::memcmp(lo, hi, 16), 0);
+    ASSERT_EQ(lo[0], 1);
+    ASSERT_EQ(lo[12], 0x10);
+
+    codepunk_result_free(result);
+    codepunk_module_free(module);
+}
+
+TEST(CApi, LoadSlice) {
+    // the module is a slice of a larger buffer, with no NUL where it ends
+    std::string buffer = std::string(CApiIR) + "garbage that is not IR {";
+    auto module = codepunk_module_load(buffer.data(), std::strlen(CApiIR), "slice", nullptr);
+    ASSERT_NE(module, nullptr);
+    ASSERT_EQ(codepunk_module_function_count(module), 2u);
+    codepunk_module_free(module);
+}
+
+TEST(CApi, LoadError) {
+    const char *broken = "define i32 @f( {";
+    char *error = nullptr;
+
+    ASSERT_EQ(codepunk_module_load(broken, std::strlen(broken), "broken", &error), nullptr);
+    ASSERT_NE(error, nullptr);
+    ASSERT_NE(std::string(error), "");
+    codepunk_string_free(error);
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <Driver.h>
+
+#include "TestIR.h"
+
+// constants flowing through a slot, which SCCP does not follow
+static const char *SlotIR = R"(
+define i32 @foo() {
+entry:
+  %a = alloca i32, align 4
+  store i32 3, i32* %a, align 4
+  %0 = load i32, i32* %a, align 4
+  %b = add i32 %0, 4
+  %c = icmp eq i32 %b, 7
+  br i1 %c, label %t, label %f
+
+t:
+  ret i32 %b
+
+f:
+  ret i32 0
+}
+)";
+
+static APInt i32(int64_t v) {
+    return APInt(32, v, true);
+}
+
+TEST(DomainAnalysis, ConstantDomain) {
+    using D = ConstantDomain;
+
+    ASSERT_TRUE(D::equals(D::add(D::constant(i32(INT32_MAX)), D::constant(i32(1)), true), D::constant(i32(INT32_MIN))));
+    ASSERT_EQ(D::sdiv(D::constant(i32(1)), D::constant(i32(0))).kind, ConstantValue::Top);
+    ASSERT_EQ(D::sdiv(D::constant(i32(INT32_MIN)), D::constant(i32(-1))).kind, ConstantValue::Top);
+    ASSERT_EQ(D::join(D::constant(i32(1)), D::constant(i32(2))).kind, ConstantValue::Top);
+    ASSERT_TRUE(D::isBottom(D::meet(D::constant(i32(1)), D::constant(i32(2)))));
+    ASSERT_TRUE(D::compare(llvm::CmpInst::ICMP_SLT, D::constant(i32(-1)), D::constant(i32(0))).equals(Ternary::True));
+    ASSERT_TRUE(D::compare(llvm::CmpInst::ICMP_EQ, D::top(32), D::constant(i32(0))).equals(Ternary::Unknown));
+
+    auto l = D::top(32), r = D::constant(i32(5));
+    D::refine(llvm::CmpInst::ICMP_EQ, l, r);
+    ASSERT_TRUE(D::equals(l, D::constant(i32(5))));
+
+    // constants wider than 64 bits print in full
+    std::string printed;
+    llvm::raw_string_ostream o(printed);
+    o << D::constant(APInt::getSignedMinValue(128));
+    ASSERT_EQ(o.str(), "-170141183460469231731687303715884105728");
+}
+
+TEST(DomainAnalysis, SignDomain) {
+    using D = SignDomain;
+    SignValue negative{SignValue::Negative}, zero{SignValue::Zero}, positive{SignValue::Positive};
+
+    ASSERT_EQ(D::add(positive, positive, true).signs, SignValue::Positive);
+    ASSERT_EQ(D::add(positive, positive, false).signs, SignValue::Positive | SignValue::Negative);
+    ASSERT_EQ(D::add(positive, zero, false).signs, SignValue::Positive);
+    ASSERT_EQ(D::sub(zero, positive, false).signs, SignValue::Negative);
+    ASSERT_EQ(D::mul(negative, negative, true).signs, SignValue::Positive);
+    ASSERT_EQ(D::sdiv(positive, negative).signs, SignValue::Negative | SignValue::Zero);
+    ASSERT_EQ(D::constant(i32(-3)).signs, SignValue::Negative);
+
+    ASSERT_TRUE(D::compare(llvm::CmpInst::ICMP_SLT, negative, D::join(zero, positive)).equals(Ternary::True));
+    ASSERT_TRUE(D::compare(llvm::CmpInst::ICMP_SGT, zero, zero).equals(Ternary::False));
+    ASSERT_TRUE(D::compare(llvm::CmpInst::ICMP_EQ, positive, positive).equals(Ternary::Unknown));
+    ASSERT_EQ(D::truth(D::fromTernary(Ternary::True)), true);
+
+    // x < 0 leaves only negative x, x >= 0 the others
+    auto l = D::top(32), r = zero;
+    D::refine(llvm::CmpInst::ICMP_SLT, l, r);
+    ASSERT_EQ(l.signs, SignValue::Negative);
+
+    l = D::top(32), r = zero;
+    D::refine(llvm::CmpInst::ICMP_SGE, l, r);
+    ASSERT_EQ(l.signs, SignValue::Zero | SignValue::Positive);
+
+    l = negative, r = zero;
+    D::refine(llvm::CmpInst::ICMP_SGT, l, r);
+    ASSERT_TRUE(D::isBottom(l));
+}
+
+TEST(DomainAnalysis, IntervalDomain) {
+    using D = IntervalDomain;
+
+    ASSERT_TRUE(D::widen(range(0, 1), range(0, 2)).equals(range(0, INT32_MAX)));
+    ASSERT_TRUE(D::widen(range(0, 1), range(-1, 1)).equals(range(INT32_MIN, 1)));
+    ASSERT_TRUE(D::widen(range(0, 1), range(0, 1)).equals(range(0, 1)));
+    ASSERT_TRUE(D::join(range(1, 0), range(3, 4)).equals(range(3, 4)));
+
+    auto l = D::top(32), r = range(10, 10);
+    D::refine(llvm::CmpInst::ICMP_SGT, l, r);
+    ASSERT_TRUE(l.equals(range(11, INT32_MAX)));
+}
+
+TEST(DomainAnalysis, MatchesIntervalAnalysis) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, RangeIR);
+    ASSERT_TRUE(mod);
+
+    // without loops there is nothing to widen, so both engines find the same intervals
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysis expected(&f);
+    expected.analyze();
+    DomainAnalysis<IntervalDomain> analysis(&f);
+    analysis.analyze();
+
+    ASSERT_TRUE(analysis.workList.empty());
+    for(const auto &bb : f) {
+        auto e = expected.at(&bb);
+        auto a = analysis.at(&bb);
+        ASSERT_EQ(e.size(), a.size());
+        for(const auto &[v, interval] : e) {
+            ASSERT_TRUE(a.at(v).equals(interval));
+        }
+    }
+    ASSERT_TRUE(analysis.at(block(f, "if.then")).at(value(f, "x.addr")).equals(range(11, 21)));
+}
+
+TEST(DomainAnalysis, Widen) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    DomainAnalysis<IntervalDomain> analysis(&f);
+    ASSERT_EQ(analysis.heads, std::set<const llvm::BasicBlock*>{block(f, "while.cond")});
+
+    analysis.analyze();
+    ASSERT_TRUE(analysis.workList.empty());
+    ASSERT_LT(analysis.iterations, 64u);
+
+    // x only grows, so its upper bound is widened away but it stays non-negative
+    auto head = analysis.at(block(f, "while.cond"));
+    ASSERT_TRUE(head.at(value(f, "x")).equals(range(0, INT32_MAX)));
+    ASSERT_TRUE(analysis.at(block(f, "while.body")).at(value(f, "inc")).equals(range(1, INT32_MAX)));
+}
+
+TEST(DomainAnalysis, Sign) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    DomainAnalysis<SignDomain> analysis(&f);
+    analysis.analyze();
+
+    ASSERT_TRUE(analysis.workList.empty());
+    ASSERT_EQ(analysis.at(block(f, "while.cond")).at(value(f, "x")).signs, SignValue::Zero | SignValue::Positive);
+    ASSERT_EQ(analysis.at(block(f, "while.body")).at(value(f, "inc")).signs, SignValue::Positive);
+    ASSERT_EQ(analysis.at(block(f, "if.end")).at(value(f, "y.addr")).signs, SignValue::Positive);
+}
+
+TEST(DomainAnalysis, Constant) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, SlotIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    DomainAnalysis<ConstantDomain> analysis(&f);
+    analysis.analyze();
+
+    // the comparison is decided, so nothing reaches the false edge
+    auto entry = analysis.at(block(f, "entry"));
+    ASSERT_TRUE(ConstantDomain::equals(entry.at(value(f, "b")), ConstantDomain::constant(i32(7))));
+    ASSERT_EQ(ConstantDomain::truth(entry.at(value(f, "c"))), true);
+    ASSERT_FALSE(analysis.at(block(f, "t")).empty());
+    ASSERT_TRUE(analysis.at(block(f, "f")).empty());
+}
+
+TEST(DomainAnalysis, Driver) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    DriverOptions options;
+    options.domain = AnalysisDomain::Sign;
+
+    std::string out;
+    llvm::raw_string_ostream o(out);
+    analyzeModule(*mod, options, o);
+    ASSERT_EQ(o.str().find("foo: (domain: sign)\n"), 0u);
+    ASSERT_NE(o.str().find(" : {0+}\n"), std::string::npos);
+}
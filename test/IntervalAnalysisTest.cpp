@@ -0,0 +1,465 @@
+#include <gtest/gtest.h>
+#include <IntervalAnalysis.h>
+
+#include "TestIR.h"
+
+TEST(IntervalAnalysis, Refine) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, RangeIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    ASSERT_TRUE(analysis.workList.empty());
+    ASSERT_TRUE(analysis.at(block(f, "if.then")).at(value(f, "x.addr")).equals(range(11, 21)));
+    ASSERT_TRUE(analysis.at(block(f, "if.end")).at(value(f, "retval")).equals(range(0, 0)));
+    ASSERT_TRUE(analysis.at(block(f, "return")).at(value(f, "retval")).equals(range(0, 21)));
+}
+
+TEST(IntervalAnalysis, RefineDirection) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, RangeIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    // x > 10 holds on the edge to the true successor, the false one gets the rest
+    auto entry = block(f, "entry");
+    ASSERT_TRUE(analysis.at(entry, block(f, "land.lhs.true")).at(value(f, "x.addr")).equals(range(11, INT32_MAX)));
+    ASSERT_TRUE(analysis.at(entry, block(f, "if.end")).at(value(f, "x.addr")).equals(range(INT32_MIN, 10)));
+
+    auto lhs = block(f, "land.lhs.true");
+    ASSERT_TRUE(analysis.at(lhs, block(f, "if.then")).at(value(f, "x.addr")).equals(range(11, 21)));
+    ASSERT_TRUE(analysis.at(lhs, block(f, "if.end")).at(value(f, "x.addr")).equals(range(22, INT32_MAX)));
+}
+
+TEST(IntervalAnalysis, ConstantPool) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, RangeIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    // 10, 22, 0 and the full i32 range, each stored once
+    ASSERT_EQ(analysis.constantPool.size(), 4u);
+
+    for(const auto &[bb, symbols] : analysis.dataMap) {
+        for(const auto &[v, interval] : symbols) {
+            ASSERT_FALSE(llvm::isa<llvm::Constant>(v));
+        }
+    }
+}
+
+TEST(IntervalAnalysis, Checkpoint) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, RangeIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysis full(&f);
+    full.analyze();
+
+    IntervalAnalysisOptions options;
+    options.checkpointOnly = true;
+    IntervalAnalysis checkpointed(&f, options);
+    checkpointed.analyze();
+
+    // entry, the join if.end and the exit return
+    ASSERT_EQ(checkpointed.dataMap.size(), 3u);
+
+    for(const auto &bb : f) {
+        ASSERT_TRUE(full.at(&bb).equals(checkpointed.at(&bb)));
+    }
+
+    // the chain land.lhs.true, if.then is replayed once for both of its blocks
+    auto all = checkpointed.atAll();
+    ASSERT_EQ(all.size(), f.size());
+    for(const auto &bb : f) {
+        ASSERT_TRUE(full.at(&bb).equals(all.at(&bb)));
+    }
+}
+
+static const char *DecidedIR = R"(
+define i32 @bar() {
+entry:
+  %a = alloca i32, align 4
+  store i32 5, i32* %a, align 4
+  %0 = load i32, i32* %a, align 4
+  %cmp = icmp slt i32 %0, 10
+  br i1 %cmp, label %then, label %else
+
+then:
+  %1 = load i32, i32* %a, align 4
+  %add = add i32 %1, 1
+  store i32 %add, i32* %a, align 4
+  br label %end
+
+else:
+  store i32 2, i32* %a, align 4
+  br label %end
+
+end:
+  %2 = load i32, i32* %a, align 4
+  ret i32 %2
+}
+)";
+
+TEST(IntervalAnalysis, Tiered) {
+    llvm::LLVMContext ctx;
+    IntervalAnalysisOptions options;
+    options.tiered = true;
+
+    {
+        auto mod = parse(ctx, DecidedIR);
+        ASSERT_TRUE(mod);
+
+        const auto &f = *mod->getFunction("bar");
+        IntervalAnalysis full(&f);
+        full.analyze();
+
+        IntervalAnalysis tiered(&f, options);
+        tiered.analyze();
+
+        ASSERT_EQ(tiered.tier, 1);
+        for(const auto &bb : f) {
+            ASSERT_TRUE(full.at(&bb).equals(tiered.at(&bb)));
+        }
+    }
+
+    {
+        auto mod = parse(ctx, RangeIR);
+        ASSERT_TRUE(mod);
+
+        const auto &f = *mod->getFunction("foo");
+        IntervalAnalysis full(&f);
+        full.analyze();
+
+        IntervalAnalysis tiered(&f, options);
+        tiered.analyze();
+
+        ASSERT_EQ(tiered.tier, 2);
+        for(const auto &bb : f) {
+            ASSERT_TRUE(full.at(&bb).equals(tiered.at(&bb)));
+        }
+    }
+}
+
+TEST(IntervalAnalysis, Budget) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysisOptions options;
+    options.iterationBudget = 64;
+    options.accelerateLoops = false;
+
+    IntervalAnalysis analysis(&f, options);
+    analysis.analyze();
+
+    ASSERT_EQ(analysis.exhausted, IntervalAnalysis::Iteration);
+    ASSERT_TRUE(analysis.workList.empty());
+    ASSERT_LT(analysis.iterations, 128u);
+
+    auto full = IntervalAnalysis::topOf(32);
+    ASSERT_TRUE(analysis.at(block(f, "while.cond")).at(value(f, "x")).equals(full));
+    ASSERT_TRUE(analysis.at(block(f, "return")).at(value(f, "retval")).equals(full));
+}
+
+TEST(IntervalAnalysis, InductionLoop) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    auto loops = InductionLoop::find(&f);
+
+    ASSERT_EQ(loops.size(), 1u);
+    const auto &loop = loops.at(block(f, "while.cond"));
+    ASSERT_EQ(loop.entries, std::vector<const llvm::BasicBlock*>{block(f, "if.end")});
+    ASSERT_EQ(loop.predicate, llvm::CmpInst::ICMP_SLT);
+    ASSERT_EQ(loop.lSlot, value(f, "x"));
+    ASSERT_EQ(loop.rSlot, value(f, "y.addr"));
+    ASSERT_TRUE(loop.singleExit);
+    ASSERT_EQ(loop.steps.at(value(f, "x")), 1);
+    ASSERT_EQ(loop.steps.at(value(f, "y.addr")), -2);
+
+    auto trips = loop.tripCount(range(0, 0), range(10, 19));
+    ASSERT_TRUE(trips);
+    ASSERT_EQ(trips->first, 4u);
+    ASSERT_EQ(trips->second, 7u);
+}
+
+TEST(IntervalAnalysis, Accelerate) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    ASSERT_TRUE(analysis.workList.empty());
+    ASSERT_LT(analysis.iterations, 32u);
+
+    // y - x starts at most at INT_MAX and shrinks by 3 on each trip
+    auto head = analysis.at(block(f, "while.cond"));
+    ASSERT_TRUE(head.at(value(f, "x")).equals(range(0, 715827883)));
+    ASSERT_TRUE(head.at(value(f, "y.addr")).equals(range(-1431655756, INT32_MAX)));
+}
+
+TEST(IntervalAnalysis, AccelerateWrapping) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, WrappingLoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    // the trip count from x < INT_MAX does not hold once x wraps, so nothing bounds z
+    ASSERT_TRUE(analysis.workList.empty());
+    ASSERT_TRUE(analysis.at(block(f, "exit")).at(value(f, "r")).equals(range(INT32_MIN, INT32_MAX)));
+}
+
+TEST(IntervalAnalysis, PreheaderLoad) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, PreheaderLoadIR);
+    ASSERT_TRUE(mod);
+
+    // a store of a value loaded before the loop is no induction step
+    const auto &f = *mod->getFunction("foo");
+    ASSERT_TRUE(InductionLoop::find(&f).empty());
+
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    ASSERT_TRUE(analysis.workList.empty());
+    ASSERT_TRUE(analysis.at(block(f, "exit")).at(value(f, "jr")).equals(range(5, 100)));
+}
+
+static const char *DeadIR = R"(
+define i32 @dead(i32 %x) {
+entry:
+  %s = alloca i32, align 4
+  store i32 0, i32* %s, align 4
+  %a = add i32 2, 3
+  %c = icmp sgt i32 %a, 4
+  br i1 %c, label %live, label %dead
+
+live:
+  %y = add i32 %x, %a
+  %v = load i32, i32* %s, align 4
+  %d = icmp sgt i32 %v, 1
+  br i1 %d, label %then, label %exit
+
+dead:
+  %z = mul i32 %x, %x
+  br label %exit
+
+then:
+  ret i32 1
+
+exit:
+  ret i32 %a
+}
+)";
+
+TEST(IntervalAnalysis, ConstantPropagation) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, DeadIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("dead");
+    IntervalAnalysis analysis(&f);
+
+    ASSERT_FALSE(analysis.constants.isExecutable(block(f, "dead")));
+    ASSERT_TRUE(analysis.constants.isExecutable(block(f, "then")));
+    ASSERT_EQ(analysis.workList.size(), 4u);
+    ASSERT_EQ(*analysis.constants.constant(value(f, "a")), 5u);
+
+    analysis.analyze();
+
+    ASSERT_TRUE(analysis.at(block(f, "dead")).empty());
+    ASSERT_TRUE(analysis.at(block(f, "live")).at(value(f, "y")).equals(IntervalAnalysis::topOf(32)));
+
+    // the comparison is only decided by the interval analysis, which then takes the false edge alone
+    ASSERT_TRUE(analysis.at(block(f, "then")).empty());
+
+    auto exit = analysis.at(block(f, "exit"));
+    ASSERT_TRUE(exit.at(value(f, "a")).equals(range(5, 5)));
+    ASSERT_TRUE(exit.at(value(f, "v")).equals(range(0, 0)));
+    ASSERT_FALSE(exit.count(value(f, "z")));
+}
+
+TEST(IntervalAnalysis, Liveness) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysisOptions options;
+    options.pruneDead = true;
+
+    IntervalAnalysis full(&f), pruned(&f, options);
+    full.analyze();
+    pruned.analyze();
+
+    ASSERT_LT(pruned.stateEntries, full.stateEntries);
+
+    auto head = pruned.at(block(f, "while.cond"));
+    ASSERT_EQ(head.size(), 5u);
+    ASSERT_FALSE(head.count(value(f, "cmp")));
+    ASSERT_FALSE(head.count(value(f, "retval")));
+
+    for(const auto &bb : f) {
+        auto expected = full.at(&bb);
+        for(const auto &[v, interval] : pruned.at(&bb)) {
+            ASSERT_TRUE(interval.equals(expected.at(v)));
+        }
+    }
+
+    auto exit = pruned.at(block(f, "return"));
+    ASSERT_EQ(exit.size(), 1u);
+}
+
+TEST(IntervalAnalysis, Arena) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysisOptions options;
+    options.accelerateLoops = false;
+
+    IntervalAnalysis analysis(&f, options);
+    analysis.analyze(100);
+
+    // states are copied and replaced on every iteration, none of them may leave the arena
+    auto memory = analysis.memory.get();
+    ASSERT_EQ(memory->states.upstream, &memory->arena);
+    ASSERT_EQ(memory->table.upstream, &memory->arena);
+    for(const auto &[bb, symbols] : analysis.dataMap) {
+        ASSERT_EQ(symbols.get_allocator().resource(), &memory->states);
+    }
+    ASSERT_EQ(analysis.newState().get_allocator().resource(), &memory->states);
+    ASSERT_EQ(analysis.table.intervals.get_allocator().resource(), &memory->table);
+
+    auto moved = std::move(analysis);
+    ASSERT_EQ(moved.dataMap.begin()->second.get_allocator().resource(), &memory->states);
+}
+
+TEST(IntervalAnalysis, ArenaReplay) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    const auto &f = *mod->getFunction("foo");
+    IntervalAnalysisOptions options;
+    options.checkpointOnly = true;
+
+    IntervalAnalysis analysis(&f, options);
+    analysis.analyze();
+    ASSERT_LT(analysis.dataMap.size(), f.size());
+
+    // replaying the blocks between checkpoints allocates from the arena too, never from the global heap
+    CountingResource global(std::pmr::new_delete_resource());
+    auto previous = std::pmr::set_default_resource(&global);
+    for(const auto &bb : f) {
+        analysis.at(&bb);
+    }
+    std::pmr::set_default_resource(previous);
+    ASSERT_EQ(global.counter.allocations, 0u);
+}
+
+TEST(IntervalAnalysis, Memory) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, LoopIR);
+    ASSERT_TRUE(mod);
+
+    IntervalAnalysisOptions options;
+    options.tiered = true;
+    IntervalAnalysis analysis(mod->getFunction("foo"), options);
+    analysis.analyze();
+
+    const auto &memory = *analysis.memory;
+    for(auto s : {AnalysisMemory::States, AnalysisMemory::Table}) {
+        ASSERT_GT(memory.peak(s), 0u);
+        ASSERT_GE(memory.peak(s), memory.counter(s).bytes);
+        ASSERT_GT(memory.peaks[AnalysisMemory::Decode][s], 0u);
+    }
+    // the loop sends the triage pass back to the fixpoint, which refines the exit condition
+    ASSERT_GT(memory.peaks[AnalysisMemory::Fixpoint][AnalysisMemory::Expressions], 0u);
+    ASSERT_EQ(memory.counter(AnalysisMemory::Expressions).bytes, 0u);
+    // everything counted is carved out of the arena chunks
+    ASSERT_GE(memory.counter(AnalysisMemory::Heap).bytes,
+            memory.counter(AnalysisMemory::States).bytes + memory.counter(AnalysisMemory::Table).bytes);
+    ASSERT_EQ(memory.peak(AnalysisMemory::Wide), 0u);
+
+    IntervalTable table(std::pmr::get_default_resource(), &analysis.memory->wide);
+    table.intern(Interval(APInt(128, 1), APInt(128, 2)));
+    ASSERT_EQ(memory.peak(AnalysisMemory::Wide), 4 * sizeof(uint64_t));
+}
+
+TEST(IntervalAnalysis, Incremental) {
+    for(int mode = 0; mode < 4; mode++) {
+        llvm::LLVMContext ctx;
+        auto mod = parse(ctx, LoopIR);
+        ASSERT_TRUE(mod);
+
+        auto &f = *mod->getFunction("foo");
+        IntervalAnalysisOptions options;
+        options.checkpointOnly = mode & 1u;
+        options.pruneDead = mode & 2u;
+
+        IntervalAnalysis analysis(&f, options);
+        analysis.analyze();
+
+        auto expectFresh = [&] {
+            IntervalAnalysis fresh(&f, options);
+            fresh.analyze();
+
+            for(const auto &bb : f) {
+                ASSERT_TRUE(fresh.at(&bb).equals(analysis.at(&bb)));
+            }
+        };
+        auto blockNamed = [&](llvm::StringRef name) {
+            return const_cast<llvm::BasicBlock*>(block(f, name));
+        };
+        auto i32 = llvm::Type::getInt32Ty(ctx);
+
+        // x starts at 5, everything from the entry on is redone
+        for(auto &inst : f.getEntryBlock()) {
+            auto store = llvm::dyn_cast<llvm::StoreInst>(&inst);
+            if(store && store->getPointerOperand() == value(f, "x")) {
+                store->setOperand(0, llvm::ConstantInt::get(i32, 5));
+                analysis.markEdited(store);
+            }
+        }
+        analysis.analyze();
+        expectFresh();
+
+        // the early return returns 7, only if.then and return are redone
+        auto early = blockNamed("if.then");
+        llvm::cast<llvm::StoreInst>(early->front()).setOperand(0, llvm::ConstantInt::get(i32, 7));
+        analysis.markEdited(early);
+        analysis.analyze();
+        // if.then, and return before and after if.then changed
+        ASSERT_LE(analysis.iterations, 3u);
+        expectFresh();
+
+        // a new edge starts over
+        auto end = blockNamed("if.end");
+        end->getTerminator()->eraseFromParent();
+        llvm::BranchInst::Create(blockNamed("while.cond"), blockNamed("return"), f.getArg(0), end);
+        analysis.markEdited(end);
+        analysis.analyze();
+        expectFresh();
+    }
+}
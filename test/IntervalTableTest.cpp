@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <IntervalTable.h>
+
+static Interval range(unsigned width, int64_t l, int64_t r) {
+    return {APInt(width, l, true), APInt(width, r, true)};
+}
+
+TEST(IntervalTable, Intern) {
+    IntervalTable table;
+
+    auto a = table.intern(range(32, 0, 10));
+    auto b = table.intern(range(32, 0, 10));
+    auto c = table.intern(range(64, 0, 10));
+    auto d = table.intern(range(32, 0, 11));
+
+    ASSERT_EQ(a, b);
+    ASSERT_NE(a, c);
+    ASSERT_NE(a, d);
+    ASSERT_EQ(table.size(), 3u);
+    ASSERT_TRUE(table[c].equals(range(64, 0, 10)));
+}
+
+TEST(IntervalTable, JoinMeet) {
+    IntervalTable table;
+
+    auto a = table.intern(range(32, 0, 10));
+    auto b = table.intern(range(32, 5, 20));
+
+    auto j = table.join(a, b);
+    ASSERT_TRUE(table[j].equals(range(32, 0, 20)));
+    ASSERT_EQ(table.join(b, a), j);
+    ASSERT_EQ(table.joins.size(), 1u);
+
+    auto m = table.meet(a, b);
+    ASSERT_TRUE(table[m].equals(range(32, 5, 10)));
+    ASSERT_EQ(table.meet(a, a), a);
+}
+
+TEST(IntervalTable, Symbols) {
+    IntervalTable table;
+    using S = IdSymbols<int>;
+
+    auto a = table.intern(range(32, 0, 10));
+    auto b = table.intern(range(32, 5, 20));
+
+    S x{{1, a}, {2, a}}, y{{2, b}, {3, b}};
+
+    auto j = S::join(table, x, y);
+    ASSERT_EQ(j.size(), 3u);
+    ASSERT_EQ(j.at(1), a);
+    ASSERT_TRUE(table[j.at(2)].equals(range(32, 0, 20)));
+    ASSERT_EQ(j.at(3), b);
+
+    auto m = S::meet(table, x, y);
+    ASSERT_EQ(m.size(), 1u);
+    ASSERT_TRUE(table[m.at(2)].equals(range(32, 5, 10)));
+
+    ASSERT_TRUE(j.equals(S::join(table, y, x)));
+}
@@ -104,6 +104,22 @@ TEST(Interval, ArthmeticOp) {
     // TODO: add tests for mul & div
 }
 
+TEST(Interval, Overflow) {
+    const auto Max = Interval(APSInt::getMaxValue(32, false));
+    const auto Full = Interval::full(32);
+
+    ASSERT_TRUE(Full.equals(Max + One));
+    ASSERT_TRUE(Full.equals(Full + One));
+    ASSERT_TRUE(Full.equals(Full - One));
+    ASSERT_TRUE(Full.equals(Max * Max));
+    ASSERT_TRUE(Full.equals(One / ZeroToOne));
+    ASSERT_TRUE(Full.equals(Interval(APSInt::getMinValue(32, false)) /
+            Interval(APSInt(APInt(32, -1, true), false))));
+
+    ASSERT_TRUE(Interval(APSInt(APInt(32, -1, true), false), APSInt(APInt(32, 0), false))
+            .equals(Zero - ZeroToOne));
+}
+
 TEST(Interval, OrderOp) {
     ASSERT_TRUE(Zero <= ZeroToOne);
     ASSERT_TRUE(ZeroToOne <= One);
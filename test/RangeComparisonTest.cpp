@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include <RangeComparison.h>
+
+static Interval interval(int l, int r) {
+    return Interval(APInt(8, l, true), APInt(8, r, true));
+}
+
+static llvm::ConstantRange range(int l, int r) {
+    return llvm::ConstantRange(APInt(8, l, true), APInt(8, r, true));
+}
+
+TEST(RangeComparison, ToConstantRange) {
+    ASSERT_EQ(toConstantRange(interval(0, 9)), range(0, 10));
+    ASSERT_EQ(toConstantRange(interval(-5, 127)), range(-5, -128));
+    ASSERT_TRUE(toConstantRange(interval(-128, 127)).isFullSet());
+    ASSERT_TRUE(toConstantRange(interval(1, 0)).isEmptySet());
+}
+
+TEST(RangeComparison, Add) {
+    RangeComparison c;
+    c.add(range(0, 10), range(0, 10));
+    c.add(range(0, 10), range(-1, 10));
+    c.add(range(0, 10), range(2, 5));
+    c.add(range(0, 10), range(5, 20));
+    c.add(range(0, 10), range(10, 20));
+    // wrapped ranges contain the values on both ends
+    c.add(range(0, 10), range(-20, 20));
+
+    ASSERT_EQ(c.equal, 1u);
+    ASSERT_EQ(c.tighter, 2u);
+    ASSERT_EQ(c.looser, 1u);
+    ASSERT_EQ(c.incomparable, 1u);
+    ASSERT_EQ(c.disjoint, 1u);
+}
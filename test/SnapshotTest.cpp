@@ -0,0 +1,261 @@
+#include <gtest/gtest.h>
+#include <Snapshot.h>
+#include <llvm/Support/FileSystem.h>
+
+// example/test.cpp: int x = 0; if(y < 10) return 0; while(x < y) { x ++; y -= 2; } return x * y;
+static const char *SnapshotIR = R"(
+define i32 @foo(i32 %y) {
+entry:
+  %retval = alloca i32, align 4
+  %y.addr = alloca i32, align 4
+  %x = alloca i32, align 4
+  store i32 %y, i32* %y.addr, align 4
+  store i32 0, i32* %x, align 4
+  %0 = load i32, i32* %y.addr, align 4
+  %cmp = icmp slt i32 %0, 10
+  br i1 %cmp, label %if.then, label %if.end
+
+if.then:
+  store i32 0, i32* %retval, align 4
+  br label %return
+
+if.end:
+  br label %while.cond
+
+while.cond:
+  %1 = load i32, i32* %x, align 4
+  %2 = load i32, i32* %y.addr, align 4
+  %cmp1 = icmp slt i32 %1, %2
+  br i1 %cmp1, label %while.body, label %while.end
+
+while.body:
+  %3 = load i32, i32* %x, align 4
+  %inc = add nsw i32 %3, 1
+  store i32 %inc, i32* %x, align 4
+  %4 = load i32, i32* %y.addr, align 4
+  %sub = sub nsw i32 %4, 2
+  store i32 %sub, i32* %y.addr, align 4
+  br label %while.cond
+
+while.end:
+  %5 = load i32, i32* %x, align 4
+  %6 = load i32, i32* %y.addr, align 4
+  %mul = mul nsw i32 %5, %6
+  store i32 %mul, i32* %retval, align 4
+  br label %return
+
+return:
+  %7 = load i32, i32* %retval, align 4
+  ret i32 %7
+}
+
+define i32 @bar(i32 %x) {
+entry:
+  %cmp = icmp sgt i32 %x, 10
+  br i1 %cmp, label %big, label %small
+
+big:
+  %a = add i32 %x, 1
+  ret i32 %a
+
+small:
+  ret i32 0
+}
+)";
+
+static std::string temporaryFile() {
+    llvm::SmallString<128> path;
+    EXPECT_FALSE(llvm::sys::fs::createTemporaryFile("codepunk", "snapshot", path));
+    return path.str().str();
+}
+
+static std::string readFile(const std::string &path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    return buffer ? buffer.get()->getBuffer().str() : "";
+}
+
+TEST(Snapshot, Resume) {
+    llvm::LLVMContext ctx;
+    std::string error;
+    auto mod = parseModule(llvm::MemoryBufferRef(SnapshotIR, "test"), ctx, error);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("foo");
+    FunctionNumbering numbering(f);
+
+    for(bool checkpointOnly : {false, true}) {
+        IntervalAnalysisOptions options;
+        options.checkpointOnly = checkpointOnly;
+
+        auto path = temporaryFile();
+        {
+            std::error_code ec;
+            SnapshotWriter writer(path, options, Snapshot::hashModule(*mod), std::nullopt, ec);
+            ASSERT_FALSE(ec);
+
+            // the first checkpoint has every stored state, later ones only what changed
+            IntervalAnalysis analysis(&f, options);
+            ASSERT_EQ(writer.checkpoint(0, numbering, analysis, false), analysis.dataMap.size());
+            ASSERT_EQ(writer.checkpoint(0, numbering, analysis, false), 0u);
+
+            // killed halfway through
+            for(int i = 0; i < 5; i++) {
+                analysis.analyze(1);
+                ASSERT_LE(writer.checkpoint(0, numbering, analysis, false), 1u);
+            }
+            ASSERT_FALSE(analysis.workList.empty());
+        }
+
+        // a record cut short is dropped, the ones before it still count
+        auto log = readFile(path);
+        Snapshot snapshot;
+        ASSERT_TRUE(snapshot.read(log + std::string("C\x40\0\0\0partial", 12)));
+        ASSERT_EQ(snapshot.header, Snapshot::encodeHeader(options, Snapshot::hashModule(*mod)));
+        ASSERT_EQ(snapshot.functions.size(), 1u);
+        ASSERT_TRUE(snapshot.functions.at(0).matches(f, numbering));
+        ASSERT_EQ(snapshot.functions.at(0).iterations, 5u);
+        ASSERT_FALSE(snapshot.functions.at(0).done);
+        ASSERT_FALSE(snapshot.read("not a snapshot"));
+
+        IntervalAnalysis resumed(&f, options);
+        ASSERT_TRUE(snapshot.read(log));
+        restoreSnapshot(resumed, snapshot.functions.at(0), numbering);
+        resumed.analyze();
+
+        IntervalAnalysis fresh(&f, options);
+        fresh.analyze();
+        ASSERT_EQ(resumed.iterations, fresh.iterations);
+        for(const auto &bb : f) {
+            ASSERT_TRUE(fresh.at(&bb).equals(resumed.at(&bb)));
+        }
+
+        llvm::sys::fs::remove(path);
+    }
+
+    // killed halfway through a record: the torn tail is cut off, so resuming twice still resumes
+    auto path = temporaryFile();
+    {
+        std::error_code ec;
+        SnapshotWriter writer(path, {}, Snapshot::hashModule(*mod), std::nullopt, ec);
+        ASSERT_FALSE(ec);
+
+        IntervalAnalysis analysis(&f);
+        analysis.analyze(3);
+        writer.checkpoint(0, numbering, analysis, false);
+        *writer.os << std::string("C\x40\0\0\0partial", 12);
+    }
+    auto torn = readFile(path);
+
+    DriverOptions options;
+    std::string expected;
+    llvm::raw_string_ostream e(expected);
+    analyzeModule(*mod, options, e);
+
+    for(int run = 0; run < 2; run++) {
+        std::string out, err;
+        llvm::raw_string_ostream o(out), er(err);
+        ASSERT_TRUE(analyzeModuleResumable(*mod, options, path, 2, o, er));
+        ASSERT_EQ(o.str(), e.str());
+        ASSERT_TRUE(er.str().empty());
+
+        auto log = readFile(path);
+        Snapshot snapshot;
+        ASSERT_EQ(snapshot.read(log), log.size());
+        ASSERT_EQ(log.compare(0, torn.size() - 12, torn, 0, torn.size() - 12), 0);
+        ASSERT_TRUE(snapshot.functions.at(0).done && snapshot.functions.at(1).done);
+    }
+
+    llvm::sys::fs::remove(path);
+}
+
+TEST(Snapshot, Driver) {
+    llvm::LLVMContext ctx;
+    std::string error;
+    auto mod = parseModule(llvm::MemoryBufferRef(SnapshotIR, "test"), ctx, error);
+    ASSERT_TRUE(mod);
+
+    DriverOptions options;
+
+    std::string expected;
+    llvm::raw_string_ostream e(expected);
+    analyzeModule(*mod, options, e);
+
+    auto path = temporaryFile();
+    auto run = [&](const DriverOptions &options, std::string &err) {
+        std::string out;
+        llvm::raw_string_ostream o(out), er(err);
+        EXPECT_TRUE(analyzeModuleResumable(*mod, options, path, 2, o, er));
+        return o.str();
+    };
+
+    std::string err;
+    ASSERT_EQ(run(options, err), e.str());
+    auto log = readFile(path);
+
+    // a finished snapshot is only read back
+    ASSERT_EQ(run(options, err), e.str());
+    ASSERT_EQ(readFile(path), log);
+
+    Snapshot snapshot;
+    ASSERT_TRUE(snapshot.read(log));
+    ASSERT_EQ(snapshot.functions.size(), 2u);
+    ASSERT_TRUE(snapshot.functions.at(0).done && snapshot.functions.at(1).done);
+    ASSERT_GT(snapshot.functions.at(0).iterations, 2u);
+    ASSERT_TRUE(err.empty());
+
+    // other options start over
+    options.analysis.tiered = true;
+    run(options, err);
+    ASSERT_NE(err.find("starting over"), std::string::npos);
+    ASSERT_TRUE(snapshot.read(readFile(path)));
+    ASSERT_EQ(snapshot.header, Snapshot::encodeHeader(options.analysis, Snapshot::hashModule(*mod)));
+
+    llvm::sys::fs::remove(path);
+}
+
+TEST(Snapshot, EditedModule) {
+    llvm::LLVMContext ctx;
+    std::string error;
+    auto mod = parseModule(llvm::MemoryBufferRef(SnapshotIR, "test"), ctx, error);
+    ASSERT_TRUE(mod);
+
+    // same functions, blocks and values, only a constant differs
+    std::string editedIR = SnapshotIR;
+    auto at = editedIR.find("icmp sgt i32 %x, 10");
+    ASSERT_NE(at, std::string::npos);
+    editedIR.replace(at, 19, "icmp sgt i32 %x, 20");
+    auto edited = parseModule(llvm::MemoryBufferRef(editedIR, "test"), ctx, error);
+    ASSERT_TRUE(edited);
+    ASSERT_NE(Snapshot::hashModule(*mod), Snapshot::hashModule(*edited));
+
+    DriverOptions options;
+    auto path = temporaryFile();
+    auto run = [&](const llvm::Module &mod, std::string &err) {
+        std::string out;
+        llvm::raw_string_ostream o(out), er(err);
+        EXPECT_TRUE(analyzeModuleResumable(mod, options, path, 2, o, er));
+        return o.str();
+    };
+    auto expect = [&](const llvm::Module &mod) {
+        std::string out;
+        llvm::raw_string_ostream o(out);
+        analyzeModule(mod, options, o);
+        return o.str();
+    };
+
+    std::string err;
+    ASSERT_EQ(run(*mod, err), expect(*mod));
+    ASSERT_TRUE(err.empty());
+
+    // the finished snapshot of the original is not taken for the edited module
+    auto out = run(*edited, err);
+    ASSERT_NE(err.find("starting over"), std::string::npos);
+    ASSERT_EQ(out, expect(*edited));
+    ASSERT_NE(out, expect(*mod));
+
+    Snapshot snapshot;
+    ASSERT_TRUE(snapshot.read(readFile(path)));
+    ASSERT_EQ(snapshot.header, Snapshot::encodeHeader(options.analysis, Snapshot::hashModule(*edited)));
+
+    llvm::sys::fs::remove(path);
+}
@@ -0,0 +1,183 @@
+#ifndef CODEPUNK_TESTIR_H
+#define CODEPUNK_TESTIR_H
+
+#include <Interval.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include <memory>
+
+// modules and lookups shared by the tests of the analyses and transforms
+
+// example/test2.cpp: if(x > 10 && x < 22) return x; return 0;
+inline const char *RangeIR = R"(
+define i32 @foo(i32 %x) {
+entry:
+  %retval = alloca i32, align 4
+  %x.addr = alloca i32, align 4
+  store i32 %x, i32* %x.addr, align 4
+  %0 = load i32, i32* %x.addr, align 4
+  %cmp = icmp sgt i32 %0, 10
+  br i1 %cmp, label %land.lhs.true, label %if.end
+
+land.lhs.true:
+  %1 = load i32, i32* %x.addr, align 4
+  %cmp1 = icmp slt i32 %1, 22
+  br i1 %cmp1, label %if.then, label %if.end
+
+if.then:
+  %2 = load i32, i32* %x.addr, align 4
+  store i32 %2, i32* %retval, align 4
+  br label %return
+
+if.end:
+  store i32 0, i32* %retval, align 4
+  br label %return
+
+return:
+  %3 = load i32, i32* %retval, align 4
+  ret i32 %3
+}
+)";
+
+// example/test.cpp: int x = 0; if(y < 10) return 0; while(x < y) { x ++; y -= 2; } return x * y;
+inline const char *LoopIR = R"(
+define i32 @foo(i32 %y) {
+entry:
+  %retval = alloca i32, align 4
+  %y.addr = alloca i32, align 4
+  %x = alloca i32, align 4
+  store i32 %y, i32* %y.addr, align 4
+  store i32 0, i32* %x, align 4
+  %0 = load i32, i32* %y.addr, align 4
+  %cmp = icmp slt i32 %0, 10
+  br i1 %cmp, label %if.then, label %if.end
+
+if.then:
+  store i32 0, i32* %retval, align 4
+  br label %return
+
+if.end:
+  br label %while.cond
+
+while.cond:
+  %1 = load i32, i32* %x, align 4
+  %2 = load i32, i32* %y.addr, align 4
+  %cmp1 = icmp slt i32 %1, %2
+  br i1 %cmp1, label %while.body, label %while.end
+
+while.body:
+  %3 = load i32, i32* %x, align 4
+  %inc = add nsw i32 %3, 1
+  store i32 %inc, i32* %x, align 4
+  %4 = load i32, i32* %y.addr, align 4
+  %sub = sub nsw i32 %4, 2
+  store i32 %sub, i32* %y.addr, align 4
+  br label %while.cond
+
+while.end:
+  %5 = load i32, i32* %x, align 4
+  %6 = load i32, i32* %y.addr, align 4
+  %mul = mul nsw i32 %5, %6
+  store i32 %mul, i32* %retval, align 4
+  br label %return
+
+return:
+  %7 = load i32, i32* %retval, align 4
+  ret i32 %7
+}
+)";
+
+// x = 0; z = 0; while(x < INT_MAX) { x += 3; z++; } return z; x wraps around before it reaches INT_MAX
+inline const char *WrappingLoopIR = R"(
+define i32 @foo() {
+entry:
+  %x = alloca i32, align 4
+  %z = alloca i32, align 4
+  store i32 0, i32* %x, align 4
+  store i32 0, i32* %z, align 4
+  br label %head
+
+head:
+  %xl = load i32, i32* %x, align 4
+  %c = icmp slt i32 %xl, 2147483647
+  br i1 %c, label %body, label %exit
+
+body:
+  %xb = load i32, i32* %x, align 4
+  %xn = add i32 %xb, 3
+  store i32 %xn, i32* %x, align 4
+  %zl = load i32, i32* %z, align 4
+  %zn = add i32 %zl, 1
+  store i32 %zn, i32* %z, align 4
+  br label %head
+
+exit:
+  %r = load i32, i32* %z, align 4
+  ret i32 %r
+}
+)";
+
+// j0 = j; j = 100; for(i = 0; i < 10; i++) j = j0 + 5; return j; the store reads j from before the loop,
+// so j is 5 after any trip and not stepped by 5 from 100
+inline const char *PreheaderLoadIR = R"(
+define i32 @foo() {
+entry:
+  %i = alloca i32, align 4
+  %j = alloca i32, align 4
+  store i32 0, i32* %j, align 4
+  store i32 0, i32* %i, align 4
+  %j0 = load i32, i32* %j, align 4
+  store i32 100, i32* %j, align 4
+  br label %head
+
+head:
+  %il = load i32, i32* %i, align 4
+  %c = icmp slt i32 %il, 10
+  br i1 %c, label %body, label %exit
+
+body:
+  %jn = add i32 %j0, 5
+  store i32 %jn, i32* %j, align 4
+  %ib = load i32, i32* %i, align 4
+  %in = add i32 %ib, 1
+  store i32 %in, i32* %i, align 4
+  br label %head
+
+exit:
+  %jr = load i32, i32* %j, align 4
+  ret i32 %jr
+}
+)";
+
+inline std::unique_ptr<llvm::Module> parse(llvm::LLVMContext &ctx, const char *ir) {
+    llvm::SMDiagnostic diag;
+    return llvm::parseIR(llvm::MemoryBufferRef(ir, "test"), diag, ctx);
+}
+
+inline const llvm::BasicBlock *block(const llvm::Function &f, llvm::StringRef name) {
+    for(const auto &bb : f) {
+        if(bb.getName() == name) return &bb;
+    }
+
+    return nullptr;
+}
+
+inline const llvm::Value *value(const llvm::Function &f, llvm::StringRef name) {
+    for(const auto &bb : f) {
+        for(const auto &inst : bb) {
+            if(inst.getName() == name) return &inst;
+        }
+    }
+
+    return nullptr;
+}
+
+inline Interval range(int64_t l, int64_t r) {
+    return {APInt(32, l, true), APInt(32, r, true)};
+}
+
+#endif //CODEPUNK_TESTIR_H
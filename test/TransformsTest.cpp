@@ -0,0 +1,355 @@
+#include <gtest/gtest.h>
+#include <Transforms.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Verifier.h>
+
+#include "TestIR.h"
+
+// s is 0 at the comparison, so only the slot analysis knows %c is false
+static const char *FoldIR = R"(
+declare void @use(i32*)
+
+define i32 @fold(i32 %x) {
+entry:
+  %s = alloca i32, align 4
+  store i32 0, i32* %s, align 4
+  %v = load i32, i32* %s, align 4
+  %c = icmp sgt i32 %v, 1
+  br i1 %c, label %then, label %exit
+
+then:
+  ret i32 1
+
+exit:
+  ret i32 %x
+}
+
+define i32 @escaped(i32 %x) {
+entry:
+  %s = alloca i32, align 4
+  store i32 0, i32* %s, align 4
+  call void @use(i32* %s)
+  %v = load i32, i32* %s, align 4
+  %c = icmp sgt i32 %v, 1
+  br i1 %c, label %then, label %exit
+
+then:
+  ret i32 1
+
+exit:
+  ret i32 %x
+}
+)";
+
+TEST(Transforms, FoldBranches) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, FoldIR);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("fold");
+    {
+        IntervalAnalysis analysis(&f);
+        analysis.analyze();
+        ASSERT_EQ(foldBranches(f, analysis), 1u);
+    }
+
+    ASSERT_FALSE(llvm::verifyFunction(f, &llvm::errs()));
+    ASSERT_EQ(f.size(), 2u);
+    ASSERT_TRUE(llvm::isa<llvm::ReturnInst>(f.back().getTerminator()));
+    ASSERT_EQ(f.back().getName(), "exit");
+}
+
+TEST(Transforms, EscapedSlot) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, FoldIR);
+    ASSERT_TRUE(mod);
+
+    // @use may store anything to s
+    auto &f = *mod->getFunction("escaped");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    ASSERT_EQ(foldBranches(f, analysis), 0u);
+    ASSERT_EQ(f.size(), 3u);
+}
+
+TEST(Transforms, Unconverged) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, FoldIR);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("fold");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze(1);
+
+    ASSERT_EQ(foldBranches(f, analysis), 0u);
+}
+
+// s counts from 0 to 10, the branch bounds it on both edges and x on the edge to positive
+static const char *CountingLoopIR = R"(
+define i32 @range(i32 %x) {
+entry:
+  %s = alloca i32, align 4
+  store i32 0, i32* %s, align 4
+  br label %head
+
+head:
+  %v = load i32, i32* %s, align 4
+  %c = icmp slt i32 %v, 10
+  br i1 %c, label %body, label %exit
+
+body:
+  %w = add i32 %v, 1
+  store i32 %w, i32* %s, align 4
+  br label %head
+
+exit:
+  %p = icmp sgt i32 %x, 0
+  br i1 %p, label %positive, label %done
+
+positive:
+  ret i32 %x
+
+done:
+  ret i32 %v
+}
+)";
+
+TEST(Transforms, AnnotateRanges) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, CountingLoopIR);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("range");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    ASSERT_EQ(annotateRanges(f, analysis), 1u);
+    ASSERT_FALSE(llvm::verifyFunction(f, &llvm::errs()));
+
+    auto load = &*f.getEntryBlock().getNextNode()->begin();
+    auto range = load->getMetadata(llvm::LLVMContext::MD_range);
+    ASSERT_TRUE(range);
+    ASSERT_EQ(llvm::mdconst::extract<llvm::ConstantInt>(range->getOperand(0))->getSExtValue(), 0);
+    ASSERT_EQ(llvm::mdconst::extract<llvm::ConstantInt>(range->getOperand(1))->getSExtValue(), 11);
+
+    // annotated loads keep their metadata
+    ASSERT_EQ(annotateRanges(f, analysis), 0u);
+}
+
+TEST(Transforms, AnnotateRangesPreheaderLoad) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, PreheaderLoadIR);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("foo");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    ASSERT_TRUE(analysis.workList.empty());
+    annotateRanges(f, analysis);
+
+    // the function returns 5, which the range of %jr has to admit
+    for(auto &inst : llvm::instructions(f)) {
+        if(inst.getName() != "jr") continue;
+
+        auto range = inst.getMetadata(llvm::LLVMContext::MD_range);
+        ASSERT_TRUE(range);
+        ASSERT_EQ(llvm::mdconst::extract<llvm::ConstantInt>(range->getOperand(0))->getSExtValue(), 5);
+        ASSERT_EQ(llvm::mdconst::extract<llvm::ConstantInt>(range->getOperand(1))->getSExtValue(), 101);
+    }
+}
+
+TEST(Transforms, AnnotateRangesWrapping) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, WrappingLoopIR);
+    ASSERT_TRUE(mod);
+
+    // the loop runs past the trip count x < INT_MAX suggests, so z is not bounded by it.
+    // only x in the body is, by the comparison alone
+    auto &f = *mod->getFunction("foo");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    ASSERT_TRUE(analysis.workList.empty());
+    ASSERT_EQ(annotateRanges(f, analysis), 1u);
+
+    std::map<std::string, llvm::MDNode*> ranges;
+    for(auto &inst : llvm::instructions(f)) {
+        if(inst.hasName()) ranges[inst.getName().str()] = inst.getMetadata(llvm::LLVMContext::MD_range);
+    }
+
+    ASSERT_FALSE(ranges["xl"]);
+    ASSERT_FALSE(ranges["zl"]);
+    ASSERT_FALSE(ranges["r"]);
+    ASSERT_TRUE(ranges["xb"]);
+    ASSERT_EQ(llvm::mdconst::extract<llvm::ConstantInt>(ranges["xb"]->getOperand(1))->getSExtValue(), INT32_MAX);
+}
+
+TEST(Transforms, InsertAssumes) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, CountingLoopIR);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("range");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    // v <= 9 in body, v >= 10 in exit, x >= 1 in positive and x <= 0 in done
+    ASSERT_EQ(insertAssumes(f, analysis), 4u);
+    ASSERT_FALSE(llvm::verifyFunction(f, &llvm::errs()));
+
+    for(auto &bb : f) {
+        if(bb.getName() != "body" && bb.getName() != "exit" && bb.getName() != "positive" && bb.getName() != "done") {
+            continue;
+        }
+
+        auto assume = llvm::dyn_cast<llvm::CallInst>(bb.begin()->getNextNode());
+        ASSERT_TRUE(assume);
+        ASSERT_EQ(assume->getIntrinsicID(), llvm::Intrinsic::assume);
+    }
+}
+
+TEST(Transforms, InferNoWrap) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, CountingLoopIR);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("range");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    // w = v + 1 with v in [0,9]
+    ASSERT_EQ(inferNoWrap(f, analysis), 1u);
+
+    auto add = llvm::cast<llvm::BinaryOperator>(&*f.getEntryBlock().getNextNode()->getNextNode()->begin());
+    ASSERT_TRUE(add->hasNoSignedWrap());
+    ASSERT_TRUE(add->hasNoUnsignedWrap());
+}
+
+TEST(Transforms, InferNoWrapWrapping) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, WrappingLoopIR);
+    ASSERT_TRUE(mod);
+
+    // both adds wrap around once the loop runs long enough, and no width holds x or z
+    auto &f = *mod->getFunction("foo");
+    {
+        IntervalAnalysis analysis(&f);
+        analysis.analyze();
+
+        ASSERT_EQ(inferNoWrap(f, analysis), 0u);
+        ASSERT_EQ(narrowWidths(f, analysis), 0u);
+    }
+
+    ASSERT_FALSE(llvm::verifyFunction(f, &llvm::errs()));
+    for(auto &inst : llvm::instructions(f)) {
+        if(auto op = llvm::dyn_cast<llvm::OverflowingBinaryOperator>(&inst)) {
+            ASSERT_FALSE(op->hasNoSignedWrap() || op->hasNoUnsignedWrap());
+        }
+    }
+}
+
+TEST(Transforms, ProvenNoWrap) {
+    auto interval = [](int l, int r) {
+        return Interval(APInt(8, l, true), APInt(8, r, true));
+    };
+
+    ASSERT_EQ(provenNoWrap(llvm::Instruction::Add, interval(0, 100), interval(0, 27)), std::make_pair(true, true));
+    ASSERT_EQ(provenNoWrap(llvm::Instruction::Add, interval(0, 100), interval(0, 28)), std::make_pair(false, true));
+    // -1 is 255 unsigned
+    ASSERT_EQ(provenNoWrap(llvm::Instruction::Add, interval(0, 10), interval(-1, -1)), std::make_pair(true, false));
+    ASSERT_EQ(provenNoWrap(llvm::Instruction::Sub, interval(10, 20), interval(0, 10)), std::make_pair(true, true));
+    ASSERT_EQ(provenNoWrap(llvm::Instruction::Sub, interval(0, 20), interval(0, 10)), std::make_pair(true, false));
+    ASSERT_EQ(provenNoWrap(llvm::Instruction::Mul, interval(-11, 11), interval(-11, 11)), std::make_pair(true, false));
+    ASSERT_EQ(provenNoWrap(llvm::Instruction::Mul, interval(0, 15), interval(0, 17)), std::make_pair(false, true));
+}
+
+// an i64 counter running from 0 to 100
+static const char *WideIR = R"(
+define i64 @wide(i64 %n) {
+entry:
+  %s = alloca i64, align 8
+  store i64 0, i64* %s, align 8
+  br label %head
+
+head:
+  %v = load i64, i64* %s, align 8
+  %c = icmp slt i64 %v, 100
+  br i1 %c, label %body, label %exit
+
+body:
+  %w = add i64 %v, 1
+  %d = mul i64 %w, 2
+  store i64 %w, i64* %s, align 8
+  br label %head
+
+exit:
+  %r = add i64 %v, %n
+  ret i64 %r
+}
+)";
+
+TEST(Transforms, NarrowWidths) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, WideIR);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("wide");
+    {
+        IntervalAnalysis analysis(&f);
+        analysis.analyze();
+
+        // the slot, c, w and d. r adds an unknown argument
+        ASSERT_EQ(narrowWidths(f, analysis), 4u);
+    }
+
+    ASSERT_FALSE(llvm::verifyFunction(f, &llvm::errs()));
+
+    auto i8 = llvm::Type::getInt8Ty(ctx), i64 = llvm::Type::getInt64Ty(ctx);
+    std::map<std::string, llvm::Type*> types;
+    for(auto &inst : llvm::instructions(f)) {
+        if(inst.hasName()) types[inst.getName().str()] = inst.getType();
+    }
+
+    ASSERT_EQ(llvm::cast<llvm::AllocaInst>(f.getEntryBlock().begin())->getAllocatedType(), i8);
+    ASSERT_EQ(types["v"], i8);
+    ASSERT_EQ(types["w"], i8);
+    // d is up to 200, which needs 16 bits
+    ASSERT_EQ(types["d"], llvm::Type::getInt16Ty(ctx));
+    ASSERT_EQ(types["r"], i64);
+}
+
+TEST(Transforms, TripCounts) {
+    llvm::LLVMContext ctx;
+    auto mod = parse(ctx, CountingLoopIR);
+    ASSERT_TRUE(mod);
+
+    auto &f = *mod->getFunction("range");
+    IntervalAnalysis analysis(&f);
+    analysis.analyze();
+
+    // s runs from 0 to 10 by 1, the body runs exactly 10 times
+    auto counts = tripCounts(f, analysis);
+    ASSERT_EQ(counts.size(), 1u);
+    ASSERT_EQ(counts.front().loop.header->getName(), "head");
+    ASSERT_EQ(counts.front().min, 10u);
+    ASSERT_EQ(counts.front().max, 10u);
+
+    ASSERT_EQ(annotateTripCounts(f, analysis), 1u);
+    ASSERT_FALSE(llvm::verifyFunction(f, &llvm::errs()));
+
+    auto latch = f.getEntryBlock().getNextNode()->getNextNode();
+    auto id = latch->getTerminator()->getMetadata(llvm::LLVMContext::MD_loop);
+    ASSERT_TRUE(id);
+    ASSERT_EQ(id->getOperand(0), id);
+
+    auto property = llvm::cast<llvm::MDNode>(id->getOperand(1));
+    ASSERT_EQ(llvm::cast<llvm::MDString>(property->getOperand(0))->getString(), TripCountProperty);
+    ASSERT_EQ(llvm::mdconst::extract<llvm::ConstantInt>(property->getOperand(1))->getZExtValue(), 10u);
+    ASSERT_EQ(llvm::mdconst::extract<llvm::ConstantInt>(property->getOperand(2))->getZExtValue(), 10u);
+
+    // annotating again replaces the property
+    ASSERT_EQ(annotateTripCounts(f, analysis), 1u);
+    ASSERT_EQ(latch->getTerminator()->getMetadata(llvm::LLVMContext::MD_loop)->getNumOperands(), 2u);
+}